@@ -0,0 +1,655 @@
+/*
+ * parg_corpus - recorded argv corpus for benchmarking parg
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parg_corpus.h"
+
+static constexpr uint64_t FNV_OFFSET = UINT64_C(0xcbf29ce484222325);
+static constexpr uint64_t FNV_PRIME = UINT64_C(0x100000001b3);
+
+/* Bytes at the end of a corpus searched for an existing table */
+static constexpr size_t TABLE_WINDOW = 64 * 1024;
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t size) {
+  const unsigned char *p = data;
+
+  for (size_t i = 0; i < size; ++i) {
+    h = (h ^ p[i]) * FNV_PRIME;
+  }
+
+  return h;
+}
+
+static uint64_t fnv1a_int(uint64_t h, int32_t v) {
+  const uint32_t u = (uint32_t)v;
+  const unsigned char b[4] = {
+      (unsigned char)u,
+      (unsigned char)(u >> 8),
+      (unsigned char)(u >> 16),
+      (unsigned char)(u >> 24),
+  };
+
+  return fnv1a(h, b, sizeof(b));
+}
+
+static uint64_t fnv1a_str(uint64_t h, const char *s) {
+  return fnv1a(h, s, strlen(s) + 1);
+}
+
+uint64_t parg_corpus_table_id(const char *optstring,
+                              const struct parg_option *longopts) {
+  uint64_t h = fnv1a_str(FNV_OFFSET, optstring);
+
+  for (int i = 0; longopts != nullptr && longopts[i].name != nullptr; ++i) {
+    h = fnv1a_str(h, longopts[i].name);
+    h = fnv1a_int(h, (int32_t)longopts[i].has_arg);
+    h = fnv1a_int(h, longopts[i].flag != nullptr);
+    h = fnv1a_int(h, longopts[i].val);
+  }
+
+  return h;
+}
+
+int parg_corpus_compute_expect(int argc, char *const argv[],
+                               const char *optstring,
+                               const struct parg_option *longopts,
+                               struct parg_corpus_expect *expect) {
+  struct parg_option *shadow = nullptr;
+  char **copy;
+  struct parg_state ps;
+  uint64_t h = FNV_OFFSET;
+  int num_longopts = 0;
+  int dummy = 0;
+  int c;
+
+  /* Redirect flags so parsing has no side effects on the caller */
+  if (longopts != nullptr) {
+    while (longopts[num_longopts].name != nullptr) {
+      ++num_longopts;
+    }
+
+    shadow = malloc((size_t)(num_longopts + 1) * sizeof(*shadow));
+
+    if (shadow == nullptr) {
+      return -1;
+    }
+
+    for (int i = 0; i <= num_longopts; ++i) {
+      shadow[i] = longopts[i];
+
+      if (shadow[i].flag != nullptr) {
+        shadow[i].flag = &dummy;
+      }
+    }
+  }
+
+  copy = malloc((size_t)(argc + 1) * sizeof(*copy));
+
+  if (copy == nullptr) {
+    free(shadow);
+    return -1;
+  }
+
+  parg_init(&ps);
+
+  while ((c = parg_getopt_long(&ps, argc, argv, optstring, shadow,
+                               nullptr)) != -1) {
+    h = fnv1a_int(h, c);
+    h = fnv1a_int(h, ps.optind);
+    h = ps.optarg != nullptr ? fnv1a_str(h, ps.optarg) : fnv1a_int(h, -1);
+  }
+
+  expect->parse_digest = fnv1a_int(h, ps.optind);
+
+  for (int i = 0; i < argc; ++i) {
+    copy[i] = argv[i];
+  }
+  copy[argc] = nullptr;
+
+  expect->optend = parg_reorder(argc, copy, optstring, shadow);
+
+  h = FNV_OFFSET;
+  for (int i = 0; i < argc; ++i) {
+    h = fnv1a_str(h, copy[i]);
+  }
+  expect->reorder_digest = h;
+
+  free(copy);
+  free(shadow);
+  return 0;
+}
+
+/*
+ * Growable byte buffer for building records.
+ */
+struct buffer {
+  unsigned char *data;
+  size_t size;
+  size_t cap;
+  bool failed;
+};
+
+static void put_bytes(struct buffer *buf, const void *data, size_t size) {
+  if (buf->failed) {
+    return;
+  }
+
+  if (buf->size + size > buf->cap) {
+    size_t cap = buf->cap ? buf->cap : 256;
+    unsigned char *p;
+
+    while (cap < buf->size + size) {
+      cap *= 2;
+    }
+
+    p = realloc(buf->data, cap);
+
+    if (p == nullptr) {
+      buf->failed = true;
+      return;
+    }
+
+    buf->data = p;
+    buf->cap = cap;
+  }
+
+  memcpy(&buf->data[buf->size], data, size);
+  buf->size += size;
+}
+
+static void put_le(struct buffer *buf, uint64_t v, int size) {
+  unsigned char b[8];
+
+  for (int i = 0; i < size; ++i) {
+    b[i] = (unsigned char)(v >> (8 * i));
+  }
+
+  put_bytes(buf, b, (size_t)size);
+}
+
+static void put_str(struct buffer *buf, const char *s) {
+  put_bytes(buf, s, strlen(s) + 1);
+}
+
+/* Fill in payload length of record starting at `start` and append it. */
+static void end_record(struct buffer *buf, size_t start) {
+  const size_t len = buf->size - start - 5;
+
+  for (int i = 0; i < 4 && !buf->failed; ++i) {
+    buf->data[start + 1 + i] = (unsigned char)(len >> (8 * i));
+  }
+
+  put_le(buf, len, 4);
+}
+
+static uint64_t get_le(const unsigned char *p, int size) {
+  uint64_t v = 0;
+
+  for (int i = size - 1; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+
+  return v;
+}
+
+/* Read exactly `size` bytes at `off`. */
+static int read_at(int fd, void *data, size_t size, off_t off) {
+  unsigned char *p = data;
+
+  while (size > 0) {
+    const ssize_t n = pread(fd, p, size, off);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (n <= 0) {
+      return -1;
+    }
+
+    p += n;
+    size -= (size_t)n;
+    off += n;
+  }
+
+  return 0;
+}
+
+static int write_all(int fd, const unsigned char *data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = write(fd, data, size);
+
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (n <= 0) {
+      return -1;
+    }
+
+    data += n;
+    size -= (size_t)n;
+  }
+
+  return 0;
+}
+
+/*
+ * Check that corpus of `size` bytes in `fd` has a valid header and ends with
+ * a whole record, then search the records in its last `TABLE_WINDOW` bytes
+ * for table `id`.
+ *
+ * Returns `1` if found, `0` if not, and `-1` if `fd` is not a corpus or ends
+ * with a partial record.
+ */
+static int find_recent_table(int fd, off_t size, uint64_t id) {
+  unsigned char head[12];
+  unsigned char *window;
+  uint64_t len;
+  size_t num;
+  size_t pos;
+  int found = 0;
+
+  if (size < 12 || read_at(fd, head, 12, 0) != 0 ||
+      memcmp(head, PARG_CORPUS_MAGIC, sizeof(PARG_CORPUS_MAGIC)) != 0 ||
+      get_le(&head[8], 4) != PARG_CORPUS_VERSION) {
+    return -1;
+  }
+
+  if (size == 12) {
+    return 0;
+  }
+
+  /* The trailing length of the last record must match its header */
+  if (size - 12 < 9 || read_at(fd, head, 4, size - 4) != 0) {
+    return -1;
+  }
+
+  len = get_le(head, 4);
+
+  if (len > (uint64_t)(size - 12 - 9) ||
+      read_at(fd, head, 5, size - 9 - (off_t)len) != 0 ||
+      get_le(&head[1], 4) != len) {
+    return -1;
+  }
+
+  num = size - 12 < (off_t)TABLE_WINDOW ? (size_t)(size - 12) : TABLE_WINDOW;
+  window = malloc(num);
+
+  if (window == nullptr || read_at(fd, window, num, size - (off_t)num) != 0) {
+    free(window);
+    return -1;
+  }
+
+  /* Walk back over the records that fit entirely in the window */
+  pos = num;
+
+  while (pos >= 9) {
+    const unsigned char *rec;
+
+    len = get_le(&window[pos - 4], 4);
+
+    if (len > pos - 9) {
+      break;
+    }
+
+    rec = &window[pos - 9 - len];
+
+    if (get_le(&rec[1], 4) != len) {
+      found = -1;
+      break;
+    }
+
+    if (rec[0] == 'T' && len >= 8 && get_le(&rec[5], 8) == id) {
+      found = 1;
+      break;
+    }
+
+    pos -= 9 + len;
+  }
+
+  free(window);
+  return found;
+}
+
+int parg_corpus_capture(const char *path, int argc, char *const argv[],
+                        const char *optstring,
+                        const struct parg_option *longopts) {
+  const uint64_t id = parg_corpus_table_id(optstring, longopts);
+  struct flock lock = {0};
+  struct parg_corpus_expect expect;
+  struct buffer buf = {0};
+  struct stat st;
+  size_t start;
+  int num_longopts = 0;
+  int found = 0;
+  int res = -1;
+  int fd;
+
+  if (argc < 0 ||
+      parg_corpus_compute_expect(argc, argv, optstring, longopts, &expect) !=
+          0) {
+    return -1;
+  }
+
+  fd = open(path, O_RDWR | O_CREAT | O_APPEND, 0644);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  /*
+   * Hold an exclusive lock from the table search through the write, so
+   * concurrent captures neither duplicate the header nor interleave
+   * records.
+   */
+  lock.l_type = F_WRLCK;
+  lock.l_whence = SEEK_SET;
+
+  while (fcntl(fd, F_SETLKW, &lock) != 0) {
+    if (errno != EINTR) {
+      goto out;
+    }
+  }
+
+  if (fstat(fd, &st) != 0) {
+    goto out;
+  }
+
+  if (st.st_size == 0) {
+    put_bytes(&buf, PARG_CORPUS_MAGIC, sizeof(PARG_CORPUS_MAGIC));
+    put_le(&buf, PARG_CORPUS_VERSION, 4);
+  } else {
+    found = find_recent_table(fd, st.st_size, id);
+  }
+
+  if (found < 0) {
+    goto out;
+  }
+
+  if (!found) {
+    start = buf.size;
+    put_le(&buf, 'T', 1);
+    put_le(&buf, 0, 4);
+    put_le(&buf, id, 8);
+    put_str(&buf, optstring);
+
+    while (longopts != nullptr && longopts[num_longopts].name != nullptr) {
+      ++num_longopts;
+    }
+
+    put_le(&buf, (uint64_t)num_longopts, 4);
+
+    for (int i = 0; i < num_longopts; ++i) {
+      put_le(&buf, (uint64_t)longopts[i].has_arg, 1);
+      put_le(&buf, longopts[i].flag != nullptr, 1);
+      put_le(&buf, (uint32_t)longopts[i].val, 4);
+      put_str(&buf, longopts[i].name);
+    }
+
+    end_record(&buf, start);
+  }
+
+  start = buf.size;
+  put_le(&buf, 'A', 1);
+  put_le(&buf, 0, 4);
+  put_le(&buf, id, 8);
+  put_le(&buf, (uint64_t)argc, 4);
+  put_le(&buf, (uint32_t)expect.optend, 4);
+  put_le(&buf, expect.parse_digest, 8);
+  put_le(&buf, expect.reorder_digest, 8);
+
+  for (int i = 0; i < argc; ++i) {
+    put_str(&buf, argv[i]);
+  }
+
+  end_record(&buf, start);
+
+  if (!buf.failed && write_all(fd, buf.data, buf.size) == 0) {
+    res = 0;
+  }
+
+out:
+  /* Closing the descriptor releases the lock */
+  if (close(fd) != 0) {
+    res = -1;
+  }
+
+  free(buf.data);
+  return res;
+}
+
+/* Target of long options that had a flag when captured */
+static int flag_sink;
+
+/*
+ * Return string at `*pos` and advance past its NUL, or `nullptr` if no NUL
+ * before `end`.
+ */
+static char *take_str(const unsigned char **pos, const unsigned char *end) {
+  const unsigned char *nul = memchr(*pos, '\0', (size_t)(end - *pos));
+  char *s = (char *)*pos;
+
+  if (nul == nullptr) {
+    return nullptr;
+  }
+
+  *pos = nul + 1;
+  return s;
+}
+
+/*
+ * Make room for one more element in `array` of `num` elements. Capacity is
+ * doubled whenever `num` is a power of two, so it need not be stored.
+ */
+static void *grow(void *array, int num, size_t elem_size) {
+  if (num > 0 && (num & (num - 1)) != 0) {
+    return array;
+  }
+
+  return realloc(array, (size_t)(num > 0 ? 2 * num : 1) * elem_size);
+}
+
+static int index_of_table(const struct parg_corpus *cp, uint64_t id) {
+  for (int i = 0; i < cp->num_tables; ++i) {
+    if (cp->tables[i].id == id) {
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+static int add_table(struct parg_corpus *cp, const unsigned char *p,
+                     const unsigned char *end) {
+  struct parg_corpus_table *tables;
+  struct parg_corpus_table *t;
+  int num_longopts;
+
+  if (end - p < 8) {
+    return -1;
+  }
+
+  if (index_of_table(cp, get_le(p, 8)) != -1) {
+    return 0;
+  }
+
+  tables = grow(cp->tables, cp->num_tables, sizeof(*tables));
+
+  if (tables == nullptr) {
+    return -1;
+  }
+
+  cp->tables = tables;
+  t = &tables[cp->num_tables];
+  t->id = get_le(p, 8);
+  p += 8;
+
+  if ((t->optstring = take_str(&p, end)) == nullptr || end - p < 4) {
+    return -1;
+  }
+
+  num_longopts = (int)get_le(p, 4);
+  p += 4;
+
+  if (num_longopts < 0 || num_longopts > end - p) {
+    return -1;
+  }
+
+  t->longopts = malloc((size_t)(num_longopts + 1) * sizeof(*t->longopts));
+
+  if (t->longopts == nullptr) {
+    return -1;
+  }
+
+  for (int i = 0; i < num_longopts; ++i) {
+    struct parg_option *opt = &t->longopts[i];
+
+    if (end - p < 6) {
+      free(t->longopts);
+      return -1;
+    }
+
+    opt->has_arg = (parg_arg_num)p[0];
+    opt->flag = p[1] ? &flag_sink : nullptr;
+    opt->val = (int32_t)(uint32_t)get_le(&p[2], 4);
+    p += 6;
+
+    if ((opt->name = take_str(&p, end)) == nullptr) {
+      free(t->longopts);
+      return -1;
+    }
+  }
+
+  t->longopts[num_longopts] = (struct parg_option){nullptr, PARG_NOARG,
+                                                   nullptr, 0};
+  cp->num_tables++;
+  return 0;
+}
+
+static int add_entry(struct parg_corpus *cp, const unsigned char *p,
+                     const unsigned char *end) {
+  struct parg_corpus_entry *entries;
+  struct parg_corpus_entry *e;
+  int table;
+
+  if (end - p < 32) {
+    return -1;
+  }
+
+  table = index_of_table(cp, get_le(p, 8));
+
+  if (table == -1) {
+    cp->skipped++;
+    return 0;
+  }
+
+  entries = grow(cp->entries, cp->num_entries, sizeof(*entries));
+
+  if (entries == nullptr) {
+    return -1;
+  }
+
+  cp->entries = entries;
+  e = &entries[cp->num_entries];
+  e->table = table;
+  e->argc = (int)get_le(&p[8], 4);
+  e->expect.optend = (int32_t)(uint32_t)get_le(&p[12], 4);
+  e->expect.parse_digest = get_le(&p[16], 8);
+  e->expect.reorder_digest = get_le(&p[24], 8);
+  p += 32;
+
+  if (e->argc < 0 || e->argc > end - p) {
+    return -1;
+  }
+
+  e->argv = malloc((size_t)(e->argc + 1) * sizeof(*e->argv));
+
+  if (e->argv == nullptr) {
+    return -1;
+  }
+
+  for (int i = 0; i < e->argc; ++i) {
+    if ((e->argv[i] = take_str(&p, end)) == nullptr) {
+      free(e->argv);
+      return -1;
+    }
+  }
+
+  e->argv[e->argc] = nullptr;
+
+  if (e->argc > cp->max_argc) {
+    cp->max_argc = e->argc;
+  }
+
+  cp->num_args += e->argc > 0 ? e->argc - 1 : 0;
+  cp->num_entries++;
+  return 0;
+}
+
+int parg_corpus_load(struct parg_corpus *cp, const void *data, size_t size) {
+  const unsigned char *bytes = data;
+  const unsigned char *end = bytes + size;
+  const unsigned char *p;
+
+  if (size < 12 ||
+      memcmp(bytes, PARG_CORPUS_MAGIC, sizeof(PARG_CORPUS_MAGIC)) != 0 ||
+      get_le(&bytes[8], 4) != PARG_CORPUS_VERSION) {
+    return -1;
+  }
+
+  p = bytes + 12;
+
+  while (p < end) {
+    uint64_t len;
+    unsigned char kind;
+
+    if (end - p < 9) {
+      return -1;
+    }
+
+    len = get_le(&p[1], 4);
+    kind = p[0];
+    p += 5;
+
+    if (len > (uint64_t)(end - p - 4) || get_le(&p[len], 4) != len) {
+      return -1;
+    }
+
+    if (kind == 'T' && add_table(cp, p, p + len) != 0) {
+      return -1;
+    }
+
+    if (kind == 'A' && add_entry(cp, p, p + len) != 0) {
+      return -1;
+    }
+
+    p += len + 4;
+  }
+
+  return 0;
+}
+
+void parg_corpus_free(struct parg_corpus *cp) {
+  for (int i = 0; i < cp->num_entries; ++i) {
+    free(cp->entries[i].argv);
+  }
+
+  for (int i = 0; i < cp->num_tables; ++i) {
+    free(cp->tables[i].longopts);
+  }
+
+  free(cp->entries);
+  free(cp->tables);
+  *cp = (struct parg_corpus){0};
+}
@@ -0,0 +1,159 @@
+/*
+ * parg_corpus - recorded argv corpus for benchmarking parg
+ *
+ * A corpus file starts with the 8 byte magic `PARGCORP` and a 32-bit
+ * version. It is followed by records, each a one byte kind, a 32-bit
+ * payload length, the payload, and the payload length again so the last
+ * record can be checked and records walked backwards from the end. All
+ * integers are little-endian, and all strings are stored with their
+ * terminating NUL so they can be used in place.
+ *
+ * Table record (kind `T`), at least one per distinct option table:
+ *
+ *     u64 table id
+ *     optstring
+ *     u32 number of long options, then for each:
+ *       u8 has_arg, u8 has_flag, i32 val, name
+ *
+ * Argv record (kind `A`), one per captured command line:
+ *
+ *     u64 table id
+ *     u32 argc
+ *     i32 value returned by parg_reorder()
+ *     u64 digest of parg_getopt_long() results
+ *     u64 digest of argv after parg_reorder()
+ *     argc strings
+ */
+
+#ifndef PARG_CORPUS_H_INCLUDED
+#define PARG_CORPUS_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "parg/parg.h"
+
+static constexpr char PARG_CORPUS_MAGIC[8] = {'P', 'A', 'R', 'G',
+                                              'C', 'O', 'R', 'P'};
+static constexpr uint32_t PARG_CORPUS_VERSION = 2;
+
+/**
+ * Results of parsing an argv, used as the expectations of a record.
+ */
+struct parg_corpus_expect {
+  int optend;              /**< Value returned by `parg_reorder()` */
+  uint64_t parse_digest;   /**< Digest of `parg_getopt_long()` results */
+  uint64_t reorder_digest; /**< Digest of argv after `parg_reorder()` */
+};
+
+/**
+ * Option table of a loaded corpus.
+ */
+struct parg_corpus_table {
+  uint64_t id;                  /**< Table identity */
+  const char *optstring;        /**< String containing option characters */
+  struct parg_option *longopts; /**< Long options, flags redirected */
+};
+
+/**
+ * Recorded argv of a loaded corpus.
+ */
+struct parg_corpus_entry {
+  int table;                        /**< Index into `tables` */
+  int argc;                         /**< Number of elements in `argv` */
+  char **argv;                      /**< Arguments, `nullptr` terminated */
+  struct parg_corpus_expect expect; /**< Results recorded at capture */
+};
+
+/**
+ * Index of records in a corpus file.
+ */
+struct parg_corpus {
+  struct parg_corpus_table *tables;   /**< Option tables */
+  struct parg_corpus_entry *entries;  /**< Recorded argvs */
+  int num_tables;                     /**< Number of `tables` */
+  int num_entries;                    /**< Number of `entries` */
+  long num_args;                      /**< Arguments, excluding `argv[0]` */
+  long skipped;                       /**< Entries with unknown table */
+  int max_argc;                       /**< Largest `argc` of any entry */
+};
+
+/**
+ * Compute identity of an option table.
+ *
+ * The identity is a hash of `optstring` and the name, argument status,
+ * value and presence of flag of each entry in `longopts`.
+ *
+ * @param optstring string containing option characters
+ * @param longopts array of `parg_option` structures, may be `nullptr`
+ * @return table identity
+ */
+[[nodiscard]] uint64_t parg_corpus_table_id(const char *optstring,
+                                            const struct parg_option *longopts);
+
+/**
+ * Parse `argv` with `parg_getopt_long()` and `parg_reorder()` and store
+ * the results in `expect`.
+ *
+ * `argv` is not modified.
+ *
+ * @param argc number of elements in `argv`
+ * @param argv array of pointers to command-line arguments
+ * @param optstring string containing option characters
+ * @param longopts array of `parg_option` structures, may be `nullptr`
+ * @param expect pointer to results
+ * @return `0` on success, `-1` on allocation failure
+ */
+[[nodiscard]] int
+parg_corpus_compute_expect(int argc, char *const argv[], const char *optstring,
+                           const struct parg_option *longopts,
+                           struct parg_corpus_expect *expect);
+
+/**
+ * Append `argv` and its option table to the corpus at `path`.
+ *
+ * The file is created if needed. The table is written unless it is among
+ * the records in the last 64 KiB of the corpus, so the cost does not grow
+ * with the size of the corpus, at the price of occasional duplicate
+ * tables. The file is locked while it is searched and
+ * appended to, so concurrent processes may capture to the same path.
+ * Intended to be called once at startup, before parsing.
+ *
+ * @param path path of corpus file
+ * @param argc number of elements in `argv`
+ * @param argv array of pointers to command-line arguments
+ * @param optstring string containing option characters
+ * @param longopts array of `parg_option` structures, may be `nullptr`
+ * @return `0` on success, `-1` on error
+ */
+[[nodiscard]] int parg_corpus_capture(const char *path, int argc,
+                                      char *const argv[],
+                                      const char *optstring,
+                                      const struct parg_option *longopts);
+
+/**
+ * Index the records of the corpus in `data`.
+ *
+ * Strings are used in place, so `data` must outlive `cp`. Long options that
+ * had a flag when captured point to an internal dummy. Repeated tables are
+ * ignored. Entries whose table
+ * is not in the corpus are counted in `skipped`.
+ *
+ * On error `cp` may be partially filled and must still be freed.
+ *
+ * @param cp pointer to zero-initialized corpus
+ * @param data contents of corpus file
+ * @param size size of `data` in bytes
+ * @return `0` on success, `-1` if `data` is malformed or allocation fails
+ */
+[[nodiscard]] int parg_corpus_load(struct parg_corpus *cp, const void *data,
+                                   size_t size);
+
+/**
+ * Free memory allocated by `parg_corpus_load()`.
+ *
+ * @param cp pointer to corpus
+ */
+void parg_corpus_free(struct parg_corpus *cp);
+
+#endif /* PARG_CORPUS_H_INCLUDED */
@@ -0,0 +1,873 @@
+/*
+ * parg_perf - hardware counter benchmarks for parg
+ *
+ * Runs each parser API over a fixed argv workload and reports instructions,
+ * cycles, branch misses, cache misses and wall-clock time per parsed
+ * argument as JSON. Counters are read with Linux `perf_event_open`; when
+ * they are unavailable the corresponding fields are `null`.
+ *
+ * With `--baseline`, results are compared against an earlier JSON report,
+ * and the exit status is nonzero if any metric regressed by more than its
+ * threshold or a benchmark is missing from the baseline. A baseline that
+ * cannot be parsed is an error. Metrics recorded in the baseline but
+ * unavailable now are reported, and with `--require-metrics` also fail the
+ * comparison.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "parg/parg.h"
+
+enum { METRIC_COUNT = 5, NUM_COUNTERS = 4, MAX_BENCHES = 8 };
+
+static const char *const metric_names[METRIC_COUNT] = {
+    "instructions", "cycles", "branch_misses", "cache_misses", "ns",
+};
+
+/* Default regression thresholds in percent, per metric */
+static double thresholds[METRIC_COUNT] = {2.0, 5.0, 10.0, 25.0, 10.0};
+
+/* Fail if a metric in the baseline is unavailable in the current run */
+static bool require_metrics = false;
+
+struct result {
+  char name[32];
+  int args;
+  bool valid[METRIC_COUNT];
+  double value[METRIC_COUNT];
+};
+
+/*
+ * Counters
+ */
+
+struct counters {
+  int fd[NUM_COUNTERS];
+  int leader; /* Index of group leader in `fd`, or `-1` if none opened */
+};
+
+#if defined(__linux__)
+static int open_counter(uint32_t type, uint64_t config, int group_fd) {
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/*
+ * Open counters as one group, so they are scheduled together and all
+ * measure the same window. The first counter that opens leads the group.
+ */
+static void counters_open(struct counters *pc) {
+  static const uint64_t configs[NUM_COUNTERS] = {
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_BRANCH_MISSES,
+      PERF_COUNT_HW_CACHE_MISSES,
+  };
+
+  pc->leader = -1;
+
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    pc->fd[i] = open_counter(PERF_TYPE_HARDWARE, configs[i],
+                             pc->leader == -1 ? -1 : pc->fd[pc->leader]);
+
+    if (pc->fd[i] != -1 && pc->leader == -1) {
+      pc->leader = i;
+    }
+  }
+}
+
+static void counters_start(const struct counters *pc) {
+  if (pc->leader != -1) {
+    ioctl(pc->fd[pc->leader], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(pc->fd[pc->leader], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+/*
+ * Stop counters and store counts, scaled for multiplexing, in `value`.
+ */
+static void counters_stop(const struct counters *pc, bool valid[],
+                          double value[]) {
+  /* Number of counters, time enabled, time running, then each count */
+  uint64_t data[3 + NUM_COUNTERS];
+  ssize_t len = -1;
+  uint64_t slot = 0;
+
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    valid[i] = false;
+  }
+
+  if (pc->leader == -1) {
+    return;
+  }
+
+  ioctl(pc->fd[pc->leader], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  len = read(pc->fd[pc->leader], data, sizeof(data));
+
+  if (len < (ssize_t)(3 * sizeof(data[0])) || data[2] == 0) {
+    return;
+  }
+
+  /* Counts are in the order the counters joined the group */
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    if (pc->fd[i] == -1) {
+      continue;
+    }
+
+    if (slot < data[0] &&
+        (size_t)len >= (3 + slot + 1) * sizeof(data[0])) {
+      valid[i] = true;
+      value[i] = (double)data[3 + slot] * ((double)data[1] / (double)data[2]);
+    }
+
+    ++slot;
+  }
+}
+
+static void counters_close(struct counters *pc) {
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    if (pc->fd[i] != -1) {
+      close(pc->fd[i]);
+      pc->fd[i] = -1;
+    }
+  }
+
+  pc->leader = -1;
+}
+#else
+static void counters_open(struct counters *pc) {
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    pc->fd[i] = -1;
+  }
+
+  pc->leader = -1;
+}
+
+static void counters_start(const struct counters *pc) { (void)pc; }
+
+static void counters_stop(const struct counters *pc, bool valid[],
+                          double value[]) {
+  (void)pc;
+  (void)value;
+
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    valid[i] = false;
+  }
+}
+
+static void counters_close(struct counters *pc) { (void)pc; }
+#endif
+
+/* Read a clock that is not stepped or slewed by time adjustments */
+static double now_ns() {
+  struct timespec ts;
+
+#if defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  timespec_get(&ts, TIME_UTC);
+#endif
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/*
+ * Workloads
+ */
+
+static char *short_argv[] = {
+    "prog", "-v",    "-vvv",  "-ofile", "-o",   "out.txt", "-s",  "-s10",
+    "-abc", "input", "-d",    "-x",     "-I",   "include", "-Ilib", "-DNAME",
+    "-D",   "X=1",   "-vq",   "-qv",    "-abo", "f",       "file", "-c",
+    "-a",   "-b",    "-cvvq", "-",      "-Wall", "-O2",    "-g",  "-s3",
+};
+
+static char *long_argv[] = {
+    "prog",          "--verbose",        "--output=out.txt", "--output",
+    "out.txt",       "--size",           "--size=10",        "--include",
+    "dir",           "--define=NAME",    "--define",         "X=1",
+    "--quiet",       "--verb",           "--out=x",          "--dry-run",
+    "--jobs=8",      "--jobs",           "4",                "--log-level=2",
+    "input",         "--color=always",   "--no-color",       "--config",
+    "/etc/tool.cfg", "--threads=16",     "--timeout=30",     "--retries=3",
+    "--verbose",     "--warnings=error", "--optimize=2",     "--debug",
+};
+
+static char *mixed_argv[] = {
+    "prog",    "a.c",      "-v",     "b.c",      "--output", "out",
+    "c.c",     "-Iinc",    "d.c",    "--define", "X",        "e.c",
+    "-s",      "f.c",      "--size", "g.c",      "-abc",     "h.c",
+    "--quiet", "i.c",      "-D",     "Y",        "j.c",      "-vvq",
+    "k.c",     "--jobs=4", "l.c",    "-o",       "out2",     "m.c",
+    "--",      "-notopt",
+};
+
+static const char short_optstring[] = "vqo:s::abcdxI:D:W:O:g";
+
+static const struct parg_option bench_longopts[] = {
+    {"verbose", PARG_NOARG, nullptr, 'v'},
+    {"quiet", PARG_NOARG, nullptr, 'q'},
+    {"output", PARG_REQARG, nullptr, 'o'},
+    {"size", PARG_OPTARG, nullptr, 's'},
+    {"include", PARG_REQARG, nullptr, 'I'},
+    {"define", PARG_REQARG, nullptr, 'D'},
+    {"dry-run", PARG_NOARG, nullptr, 'n'},
+    {"jobs", PARG_REQARG, nullptr, 'j'},
+    {"log-level", PARG_REQARG, nullptr, 'l'},
+    {"color", PARG_OPTARG, nullptr, 'C'},
+    {"no-color", PARG_NOARG, nullptr, 'N'},
+    {"config", PARG_REQARG, nullptr, 'F'},
+    {"threads", PARG_REQARG, nullptr, 't'},
+    {"timeout", PARG_REQARG, nullptr, 'T'},
+    {"retries", PARG_REQARG, nullptr, 'r'},
+    {"warnings", PARG_REQARG, nullptr, 'W'},
+    {"optimize", PARG_REQARG, nullptr, 'O'},
+    {"debug", PARG_NOARG, nullptr, 'g'},
+    {nullptr, PARG_NOARG, nullptr, 0},
+};
+
+enum {
+  SHORT_ARGC = sizeof(short_argv) / sizeof(short_argv[0]),
+  LONG_ARGC = sizeof(long_argv) / sizeof(long_argv[0]),
+  MIXED_ARGC = sizeof(mixed_argv) / sizeof(mixed_argv[0]),
+};
+
+/* Accumulates results so the parser calls cannot be optimized away */
+static volatile int sink;
+
+static void run_getopt(long iterations) {
+  struct parg_state ps;
+  int acc = 0;
+  int c;
+
+  for (long it = 0; it < iterations; ++it) {
+    parg_init(&ps);
+
+    while ((c = parg_getopt(&ps, SHORT_ARGC, short_argv, short_optstring)) !=
+           -1) {
+      acc += c;
+    }
+  }
+
+  sink = acc;
+}
+
+static void run_getopt_long(long iterations) {
+  struct parg_state ps;
+  int acc = 0;
+  int c;
+
+  for (long it = 0; it < iterations; ++it) {
+    parg_init(&ps);
+
+    while ((c = parg_getopt_long(&ps, LONG_ARGC, long_argv, short_optstring,
+                                 bench_longopts, nullptr)) != -1) {
+      acc += c;
+    }
+  }
+
+  sink = acc;
+}
+
+static void run_reorder(long iterations) {
+  char *argv[MIXED_ARGC];
+  int acc = 0;
+
+  for (long it = 0; it < iterations; ++it) {
+    memcpy(argv, mixed_argv, sizeof(argv));
+    acc += parg_reorder(MIXED_ARGC, argv, short_optstring, bench_longopts);
+  }
+
+  sink = acc;
+}
+
+struct bench {
+  const char *name;
+  int args;
+  void (*run)(long iterations);
+};
+
+static const struct bench benches[] = {
+    {"getopt", SHORT_ARGC - 1, run_getopt},
+    {"getopt_long", LONG_ARGC - 1, run_getopt_long},
+    {"reorder", MIXED_ARGC - 1, run_reorder},
+};
+
+enum { NUM_BENCHES = sizeof(benches) / sizeof(benches[0]) };
+
+static void run_bench(const struct bench *bench, struct counters *pc,
+                      long iterations, struct result *res) {
+  const double per_arg = 1.0 / ((double)iterations * bench->args);
+  double start;
+
+  memset(res, 0, sizeof(*res));
+  snprintf(res->name, sizeof(res->name), "%s", bench->name);
+  res->args = bench->args;
+
+  /* Warm up caches and branch predictors */
+  bench->run(iterations / 10 + 1);
+
+  start = now_ns();
+  counters_start(pc);
+  bench->run(iterations);
+  counters_stop(pc, res->valid, res->value);
+  res->value[METRIC_COUNT - 1] = now_ns() - start;
+  res->valid[METRIC_COUNT - 1] = true;
+
+  for (int m = 0; m < METRIC_COUNT; ++m) {
+    if (res->valid[m]) {
+      res->value[m] *= per_arg;
+    }
+  }
+}
+
+/*
+ * JSON
+ */
+
+static void write_json(FILE *f, const struct result res[], int num,
+                       long iterations) {
+  fprintf(f, "{\n  \"version\": 1,\n  \"unit\": \"per_argument\",\n");
+  fprintf(f, "  \"iterations\": %ld,\n  \"benchmarks\": [\n", iterations);
+
+  for (int i = 0; i < num; ++i) {
+    fprintf(f, "    {\"name\": \"%s\", \"args\": %d", res[i].name,
+            res[i].args);
+
+    for (int m = 0; m < METRIC_COUNT; ++m) {
+      if (res[i].valid[m]) {
+        fprintf(f, ", \"%s\": %.4f", metric_names[m], res[i].value[m]);
+      } else {
+        fprintf(f, ", \"%s\": null", metric_names[m]);
+      }
+    }
+
+    fprintf(f, "}%s\n", i + 1 < num ? "," : "");
+  }
+
+  fprintf(f, "  ]\n}\n");
+}
+
+/*
+ * Minimal JSON reader, enough to load a report regardless of layout.
+ */
+
+struct json {
+  const char *p;
+  int depth;
+};
+
+static void json_ws(struct json *js) {
+  while (*js->p == ' ' || *js->p == '\t' || *js->p == '\n' ||
+         *js->p == '\r') {
+    ++js->p;
+  }
+}
+
+/* Consume `c` after optional whitespace. */
+static bool json_char(struct json *js, char c) {
+  json_ws(js);
+
+  if (*js->p != c) {
+    return false;
+  }
+
+  ++js->p;
+  return true;
+}
+
+static bool json_literal(struct json *js, const char *lit) {
+  const size_t len = strlen(lit);
+
+  json_ws(js);
+
+  if (strncmp(js->p, lit, len) != 0) {
+    return false;
+  }
+
+  js->p += len;
+  return true;
+}
+
+/*
+ * Parse string into `out` of size `cap`, or skip it if `out` is `nullptr`.
+ *
+ * Escapes other than `\"` and `\\` are kept as is, which is sufficient for
+ * comparing names and keys.
+ */
+static bool json_string(struct json *js, char *out, size_t cap) {
+  size_t len = 0;
+
+  if (!json_char(js, '"')) {
+    return false;
+  }
+
+  while (*js->p != '"') {
+    char c = *js->p++;
+
+    if ((unsigned char)c < 0x20) {
+      return false;
+    }
+
+    if (c == '\\') {
+      c = *js->p++;
+
+      if (c == '\0') {
+        return false;
+      }
+    }
+
+    if (out != nullptr) {
+      if (len + 1 >= cap) {
+        return false;
+      }
+
+      out[len++] = c;
+    }
+  }
+
+  ++js->p;
+
+  if (out != nullptr) {
+    out[len] = '\0';
+  }
+
+  return true;
+}
+
+static bool json_number(struct json *js, double *value) {
+  char *end = nullptr;
+
+  json_ws(js);
+
+  if (*js->p != '-' && (*js->p < '0' || *js->p > '9')) {
+    return false;
+  }
+
+  *value = strtod(js->p, &end);
+
+  if (end == js->p) {
+    return false;
+  }
+
+  js->p = end;
+  return true;
+}
+
+/* Skip any value, limiting nesting depth. */
+static bool json_skip(struct json *js) {
+  double value;
+  bool ok = true;
+
+  json_ws(js);
+
+  if (*js->p == '"') {
+    return json_string(js, nullptr, 0);
+  }
+
+  if (*js->p != '{' && *js->p != '[') {
+    return json_literal(js, "null") || json_literal(js, "true") ||
+           json_literal(js, "false") || json_number(js, &value);
+  }
+
+  if (++js->depth > 32) {
+    return false;
+  }
+
+  if (*js->p++ == '{') {
+    if (!json_char(js, '}')) {
+      do {
+        ok = json_string(js, nullptr, 0) && json_char(js, ':') &&
+             json_skip(js);
+      } while (ok && json_char(js, ','));
+
+      ok = ok && json_char(js, '}');
+    }
+  } else if (!json_char(js, ']')) {
+    do {
+      ok = json_skip(js);
+    } while (ok && json_char(js, ','));
+
+    ok = ok && json_char(js, ']');
+  }
+
+  --js->depth;
+  return ok;
+}
+
+/* Parse one benchmark object into `r`. */
+static bool json_benchmark(struct json *js, struct result *r) {
+  char key[32];
+  bool has_name = false;
+
+  memset(r, 0, sizeof(*r));
+
+  if (!json_char(js, '{')) {
+    return false;
+  }
+
+  if (json_char(js, '}')) {
+    return false;
+  }
+
+  do {
+    bool ok = false;
+
+    if (!json_string(js, key, sizeof(key)) || !json_char(js, ':')) {
+      return false;
+    }
+
+    if (strcmp(key, "name") == 0) {
+      ok = json_string(js, r->name, sizeof(r->name));
+      has_name = ok;
+    } else if (strcmp(key, "args") == 0) {
+      double args;
+
+      ok = json_number(js, &args) && args >= 0.0 && args <= INT_MAX;
+      r->args = ok ? (int)args : 0;
+    } else {
+      int m = 0;
+
+      while (m < METRIC_COUNT && strcmp(key, metric_names[m]) != 0) {
+        ++m;
+      }
+
+      if (m == METRIC_COUNT) {
+        ok = json_skip(js);
+      } else if (json_literal(js, "null")) {
+        ok = true;
+      } else {
+        ok = json_number(js, &r->value[m]);
+        r->valid[m] = ok;
+      }
+    }
+
+    if (!ok) {
+      return false;
+    }
+  } while (json_char(js, ','));
+
+  return json_char(js, '}') && has_name;
+}
+
+/*
+ * Parse the `benchmarks` array of a report written by `write_json()`.
+ *
+ * Returns number of benchmarks read, or `-1` if the file cannot be read, is
+ * not a valid report, contains no benchmarks or more than `max`.
+ */
+static int read_json(const char *path, struct result res[], int max) {
+  FILE *f = fopen(path, "rb");
+  struct json js = {0};
+  char key[32];
+  char *text = nullptr;
+  size_t size = 0;
+  bool ok = false;
+  int num = -1;
+
+  if (f == nullptr) {
+    return -1;
+  }
+
+  /* Read whole file, NUL-terminated */
+  for (;;) {
+    char *p = realloc(text, size + 4096 + 1);
+    size_t n;
+
+    if (p == nullptr) {
+      ok = false;
+      break;
+    }
+
+    text = p;
+    n = fread(&text[size], 1, 4096, f);
+    size += n;
+
+    if (n < 4096) {
+      ok = ferror(f) == 0;
+      break;
+    }
+  }
+
+  fclose(f);
+
+  if (!ok) {
+    free(text);
+    return -1;
+  }
+
+  text[size] = '\0';
+  js.p = text;
+
+  ok = json_char(&js, '{') && !json_char(&js, '}');
+
+  while (ok) {
+    ok = json_string(&js, key, sizeof(key)) && json_char(&js, ':');
+
+    if (ok && strcmp(key, "benchmarks") == 0 && num < 0) {
+      num = 0;
+      ok = json_char(&js, '[');
+
+      while (ok && !json_char(&js, ']')) {
+        ok = num < max && (num == 0 || json_char(&js, ',')) &&
+             json_benchmark(&js, &res[num]);
+        num += ok;
+      }
+    } else if (ok) {
+      ok = json_skip(&js);
+    }
+
+    if (!ok || !json_char(&js, ',')) {
+      break;
+    }
+  }
+
+  ok = ok && json_char(&js, '}');
+  json_ws(&js);
+  ok = ok && *js.p == '\0' && (size_t)(js.p - text) == size;
+
+  free(text);
+  return ok && num > 0 ? num : -1;
+}
+
+/*
+ * Compare `cur` against `base`, printing a line per compared metric.
+ *
+ * Returns number of metrics exceeding their threshold plus number of
+ * benchmarks missing from `base`. With `require_metrics`, metrics present in
+ * `base` but unavailable in `cur` are also counted.
+ */
+static int compare(const struct result cur[], int num_cur,
+                   const struct result base[], int num_base) {
+  int failures = 0;
+
+  for (int i = 0; i < num_cur; ++i) {
+    const struct result *b = nullptr;
+
+    for (int j = 0; j < num_base; ++j) {
+      if (strcmp(cur[i].name, base[j].name) == 0) {
+        b = &base[j];
+        break;
+      }
+    }
+
+    if (b == nullptr) {
+      fprintf(stderr, "%-12s not in baseline\n", cur[i].name);
+      ++failures;
+      continue;
+    }
+
+    for (int m = 0; m < METRIC_COUNT; ++m) {
+      double change;
+      bool regressed;
+
+      if (!b->valid[m]) {
+        continue;
+      }
+
+      if (!cur[i].valid[m]) {
+        failures += require_metrics;
+        fprintf(stderr, "%-12s %-14s %12.4f -> %12s %8s %s\n", cur[i].name,
+                metric_names[m], b->value[m], "null", "",
+                require_metrics ? "UNAVAILABLE" : "unavailable");
+        continue;
+      }
+
+      if (b->value[m] <= 0.0) {
+        continue;
+      }
+
+      change = (cur[i].value[m] - b->value[m]) / b->value[m] * 100.0;
+      regressed = change > thresholds[m];
+      failures += regressed;
+
+      fprintf(stderr, "%-12s %-14s %12.4f -> %12.4f %+7.2f%% %s\n",
+              cur[i].name, metric_names[m], b->value[m], cur[i].value[m],
+              change, regressed ? "REGRESSION" : "ok");
+    }
+  }
+
+  return failures;
+}
+
+/*
+ * Parse threshold of form `metric=percent` into `thresholds`.
+ */
+static int set_threshold(const char *text) {
+  const size_t len = strcspn(text, "=");
+
+  for (int m = 0; m < METRIC_COUNT; ++m) {
+    if (strlen(metric_names[m]) == len &&
+        strncmp(text, metric_names[m], len) == 0 && text[len] == '=') {
+      char *end = nullptr;
+      const double pct = strtod(&text[len + 1], &end);
+
+      if (end == &text[len + 1] || *end != '\0' || pct < 0.0) {
+        return -1;
+      }
+
+      thresholds[m] = pct;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+static void print_usage(const char *exe) {
+  printf("Usage: %s [options]\n", exe);
+  printf("\n");
+  printf("Options:\n");
+  printf("  -h, --help               Show this help message\n");
+  printf("  -n, --iterations N       Iterations per benchmark\n");
+  printf("  -o, --output FILE        Write JSON report to FILE\n");
+  printf("  -b, --baseline FILE      Compare against JSON report in FILE\n");
+  printf("  -t, --threshold M=PCT    Allowed regression for metric M\n");
+  printf("  -r, --require-metrics    Fail if a baseline metric is "
+         "unavailable\n");
+  printf("\n");
+  printf("Metrics: instructions, cycles, branch_misses, cache_misses, ns\n");
+}
+
+int main(int argc, char *argv[]) {
+  static const struct parg_option longopts[] = {
+      {"help", PARG_NOARG, nullptr, 'h'},
+      {"iterations", PARG_REQARG, nullptr, 'n'},
+      {"output", PARG_REQARG, nullptr, 'o'},
+      {"baseline", PARG_REQARG, nullptr, 'b'},
+      {"threshold", PARG_REQARG, nullptr, 't'},
+      {"require-metrics", PARG_NOARG, nullptr, 'r'},
+      {nullptr, PARG_NOARG, nullptr, 0},
+  };
+  struct result res[NUM_BENCHES];
+  struct result base[MAX_BENCHES];
+  struct parg_state ps;
+  struct counters pc;
+  const char *output = nullptr;
+  const char *baseline = nullptr;
+  long iterations = 20000;
+  bool any_counter = false;
+  int status = 0;
+  int opt;
+
+  parg_init(&ps);
+
+  while ((opt = parg_getopt_long(&ps, argc, argv, ":hn:o:b:t:r", longopts,
+                                 nullptr)) != -1) {
+    switch (opt) {
+    case 'h':
+      print_usage(argv[0]);
+      return 0;
+    case 'n': {
+      char *end = nullptr;
+
+      errno = 0;
+      iterations = strtol(ps.optarg, &end, 10);
+
+      if (errno != 0 || end == ps.optarg || *end != '\0' || iterations < 1) {
+        fprintf(stderr, "Invalid iteration count: %s\n", ps.optarg);
+        return 2;
+      }
+      break;
+    }
+    case 'o':
+      output = ps.optarg;
+      break;
+    case 'b':
+      baseline = ps.optarg;
+      break;
+    case 't':
+      if (set_threshold(ps.optarg) != 0) {
+        fprintf(stderr, "Invalid threshold: %s\n", ps.optarg);
+        return 2;
+      }
+      break;
+    case 'r':
+      require_metrics = true;
+      break;
+    case 1:
+      fprintf(stderr, "Unexpected argument: %s\n", ps.optarg);
+      return 2;
+    case ':':
+      fprintf(stderr, "Missing value for option: %s\n", argv[ps.optind - 1]);
+      return 2;
+    default:
+      fprintf(stderr, "Unknown option: %s\n", argv[ps.optind - 1]);
+      return 2;
+    }
+  }
+
+  counters_open(&pc);
+
+  for (int i = 0; i < NUM_COUNTERS; ++i) {
+    any_counter = any_counter || pc.fd[i] != -1;
+  }
+
+  if (!any_counter) {
+    fprintf(stderr, "Hardware counters unavailable, reporting wall-clock "
+                    "time only\n");
+  }
+
+  for (int i = 0; i < NUM_BENCHES; ++i) {
+    run_bench(&benches[i], &pc, iterations, &res[i]);
+  }
+
+  counters_close(&pc);
+
+  if (output != nullptr) {
+    FILE *f = fopen(output, "w");
+
+    if (f == nullptr) {
+      fprintf(stderr, "Unable to write %s\n", output);
+      return 2;
+    }
+
+    write_json(f, res, NUM_BENCHES, iterations);
+    fclose(f);
+  } else {
+    write_json(stdout, res, NUM_BENCHES, iterations);
+  }
+
+  if (baseline != nullptr) {
+    const int num_base = read_json(baseline, base, MAX_BENCHES);
+
+    if (num_base < 0) {
+      fprintf(stderr, "Unable to read baseline %s, or it is not a report\n",
+              baseline);
+      return 2;
+    }
+
+    if (compare(res, NUM_BENCHES, base, num_base) != 0) {
+      status = 1;
+    }
+  }
+
+  return status;
+}
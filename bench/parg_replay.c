@@ -0,0 +1,248 @@
+/*
+ * parg_replay - replay a recorded argv corpus through parg
+ *
+ * Memory-maps a corpus written by `parg_corpus_capture()`, runs
+ * `parg_getopt_long()` and `parg_reorder()` over every recorded argv, and
+ * reports throughput. Results are checked against the expectations stored
+ * with each record, and the exit status is nonzero on any mismatch.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parg_corpus.h"
+
+/* Read a clock that is not stepped or slewed by time adjustments */
+static double now_ns() {
+  struct timespec ts;
+
+#if defined(CLOCK_MONOTONIC)
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#else
+  timespec_get(&ts, TIME_UTC);
+#endif
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Accumulates results so the parser calls cannot be optimized away */
+static volatile int sink;
+
+static double replay_getopt_long(const struct parg_corpus *cp, long iterations) {
+  const double start = now_ns();
+  int acc = 0;
+
+  for (long it = 0; it < iterations; ++it) {
+    for (int i = 0; i < cp->num_entries; ++i) {
+      const struct parg_corpus_entry *e = &cp->entries[i];
+      const struct parg_corpus_table *t = &cp->tables[e->table];
+      struct parg_state ps;
+      int c;
+
+      parg_init(&ps);
+
+      while ((c = parg_getopt_long(&ps, e->argc, e->argv, t->optstring,
+                                   t->longopts, nullptr)) != -1) {
+        acc += c;
+      }
+    }
+  }
+
+  sink = acc;
+  return now_ns() - start;
+}
+
+static double replay_reorder(const struct parg_corpus *cp, long iterations,
+                             char **scratch) {
+  const double start = now_ns();
+  int acc = 0;
+
+  for (long it = 0; it < iterations; ++it) {
+    for (int i = 0; i < cp->num_entries; ++i) {
+      const struct parg_corpus_entry *e = &cp->entries[i];
+      const struct parg_corpus_table *t = &cp->tables[e->table];
+
+      memcpy(scratch, e->argv, (size_t)(e->argc + 1) * sizeof(*scratch));
+      acc += parg_reorder(e->argc, scratch, t->optstring, t->longopts);
+    }
+  }
+
+  sink = acc;
+  return now_ns() - start;
+}
+
+/*
+ * Check each entry against its recorded expectations.
+ *
+ * Returns number of mismatches, or `-1` on allocation failure.
+ */
+static int verify(const struct parg_corpus *cp) {
+  int mismatches = 0;
+
+  for (int i = 0; i < cp->num_entries; ++i) {
+    const struct parg_corpus_entry *e = &cp->entries[i];
+    const struct parg_corpus_table *t = &cp->tables[e->table];
+    struct parg_corpus_expect got;
+
+    if (parg_corpus_compute_expect(e->argc, e->argv, t->optstring,
+                                   t->longopts, &got) != 0) {
+      return -1;
+    }
+
+    if (got.optend != e->expect.optend ||
+        got.parse_digest != e->expect.parse_digest ||
+        got.reorder_digest != e->expect.reorder_digest) {
+      if (mismatches < 10) {
+        fprintf(stderr, "Entry %d (%s, argc %d) does not match recording\n",
+                i, e->argc > 0 ? e->argv[0] : "", e->argc);
+      }
+
+      ++mismatches;
+    }
+  }
+
+  return mismatches;
+}
+
+static void report(const char *name, long args, double ns) {
+  printf("%-12s %12.0f ns  %8.2f ns/arg  %8.2f Margs/s\n", name, ns,
+         args > 0 ? ns / (double)args : 0.0,
+         ns > 0.0 ? (double)args / ns * 1e3 : 0.0);
+}
+
+static void print_usage(const char *exe) {
+  printf("Usage: %s [options] CORPUS\n", exe);
+  printf("\n");
+  printf("Options:\n");
+  printf("  -h, --help               Show this help message\n");
+  printf("  -n, --iterations N       Passes over the corpus per API\n");
+}
+
+int main(int argc, char *argv[]) {
+  static const struct parg_option longopts[] = {
+      {"help", PARG_NOARG, nullptr, 'h'},
+      {"iterations", PARG_REQARG, nullptr, 'n'},
+      {nullptr, PARG_NOARG, nullptr, 0},
+  };
+  struct parg_corpus cp = {0};
+  struct parg_state ps;
+  struct stat st;
+  const char *path = nullptr;
+  char **scratch;
+  void *data;
+  long iterations = 100;
+  int status = 0;
+  int mismatches;
+  int opt;
+  int fd;
+
+  parg_init(&ps);
+
+  while ((opt = parg_getopt_long(&ps, argc, argv, ":hn:", longopts,
+                                 nullptr)) != -1) {
+    switch (opt) {
+    case 1:
+      if (path != nullptr) {
+        fprintf(stderr, "Unexpected argument: %s\n", ps.optarg);
+        return 2;
+      }
+      path = ps.optarg;
+      break;
+    case 'h':
+      print_usage(argv[0]);
+      return 0;
+    case 'n': {
+      char *end = nullptr;
+
+      errno = 0;
+      iterations = strtol(ps.optarg, &end, 10);
+
+      if (errno != 0 || end == ps.optarg || *end != '\0' || iterations < 1) {
+        fprintf(stderr, "Invalid iteration count: %s\n", ps.optarg);
+        return 2;
+      }
+      break;
+    }
+    case ':':
+      fprintf(stderr, "Missing value for option: %s\n", argv[ps.optind - 1]);
+      return 2;
+    default:
+      fprintf(stderr, "Unknown option: %s\n", argv[ps.optind - 1]);
+      return 2;
+    }
+  }
+
+  if (path == nullptr) {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  fd = open(path, O_RDONLY);
+
+  if (fd == -1 || fstat(fd, &st) != 0 || st.st_size == 0) {
+    fprintf(stderr, "Unable to read corpus %s\n", path);
+
+    if (fd != -1) {
+      close(fd);
+    }
+
+    return 2;
+  }
+
+  data = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    fprintf(stderr, "Unable to map corpus %s\n", path);
+    return 2;
+  }
+
+  if (parg_corpus_load(&cp, data, (size_t)st.st_size) != 0) {
+    fprintf(stderr, "Malformed corpus %s\n", path);
+    parg_corpus_free(&cp);
+    munmap(data, (size_t)st.st_size);
+    return 2;
+  }
+
+  scratch = malloc((size_t)(cp.max_argc + 1) * sizeof(*scratch));
+
+  if (scratch == nullptr) {
+    fprintf(stderr, "Out of memory\n");
+    parg_corpus_free(&cp);
+    munmap(data, (size_t)st.st_size);
+    return 2;
+  }
+
+  printf("corpus       %d entries, %ld arguments, %d tables, %ld skipped\n",
+         cp.num_entries, cp.num_args, cp.num_tables, cp.skipped);
+
+  report("getopt_long", cp.num_args * iterations,
+         replay_getopt_long(&cp, iterations));
+  report("reorder", cp.num_args * iterations,
+         replay_reorder(&cp, iterations, scratch));
+
+  mismatches = verify(&cp);
+
+  if (mismatches < 0) {
+    fprintf(stderr, "Out of memory\n");
+    status = 2;
+  } else if (mismatches != 0) {
+    fprintf(stderr, "%d entries do not match recorded results\n", mismatches);
+    status = 1;
+  } else {
+    printf("all entries match recorded results\n");
+  }
+
+  free(scratch);
+  parg_corpus_free(&cp);
+  munmap(data, (size_t)st.st_size);
+  return status;
+}
@@ -1,33 +1,60 @@
 const std = @import("std");
 
-pub fn build(b: *std.Build) void {
-    const target = b.standardTargetOptions(.{});
-    const optimize = b.standardOptimizeOption(.{});
-    const base_c_flags = [_][]const u8{
-        "-std=c23",
-        "-Wall",
-        "-Wextra",
-        "-Wpedantic",
-        "-Werror",
-    };
-    const c_flags: []const []const u8 = &base_c_flags;
-    const sanitize_c: std.zig.SanitizeC = if (optimize == .Debug) .full else .off;
+const base_c_flags = [_][]const u8{
+    "-std=c23",
+    "-Wall",
+    "-Wextra",
+    "-Wpedantic",
+    "-Werror",
+};
+const freestanding_c_flags = base_c_flags ++ [_][]const u8{
+    "-ffreestanding",
+    "-DPARG_FREESTANDING",
+};
+
+/// Create a module compiling src/parg.c, optionally without libc.
+fn createPargModule(
+    b: *std.Build,
+    target: std.Build.ResolvedTarget,
+    optimize: std.builtin.OptimizeMode,
+    freestanding: bool,
+) *std.Build.Module {
+    const flags: []const []const u8 = if (freestanding)
+        &freestanding_c_flags
+    else
+        &base_c_flags;
+    const sanitize_c: std.zig.SanitizeC = if (optimize == .Debug and !freestanding) .full else .off;
 
-    const lib_module = b.createModule(.{
+    const module = b.createModule(.{
         .target = target,
         .optimize = optimize,
-        .link_libc = true,
+        .link_libc = !freestanding,
         .sanitize_c = sanitize_c,
+        .stack_protector = if (freestanding) false else null,
     });
-    lib_module.addIncludePath(b.path("include"));
-    lib_module.addCSourceFile(.{
+    module.addIncludePath(b.path("include"));
+    module.addCSourceFile(.{
         .file = b.path("src/parg.c"),
-        .flags = c_flags,
+        .flags = flags,
     });
 
+    return module;
+}
+
+pub fn build(b: *std.Build) void {
+    const target = b.standardTargetOptions(.{});
+    const optimize = b.standardOptimizeOption(.{});
+    const freestanding = b.option(
+        bool,
+        "freestanding",
+        "Build the library without libc, using its own string functions",
+    ) orelse false;
+    const c_flags: []const []const u8 = &base_c_flags;
+    const sanitize_c: std.zig.SanitizeC = if (optimize == .Debug) .full else .off;
+
     const lib = b.addLibrary(.{
         .name = "parg",
-        .root_module = lib_module,
+        .root_module = createPargModule(b, target, optimize, freestanding),
         .linkage = .static,
     });
 
@@ -78,6 +105,171 @@ pub fn build(b: *std.Build) void {
     b.step("run", "Run the example").dependOn(&run_cmd.step);
 
     const run_tests_cmd = b.addRunArtifact(tests_exe);
-    b.step("test", "Run parser regression tests")
-        .dependOn(&run_tests_cmd.step);
+    const test_step = b.step("test", "Run parser regression tests");
+    test_step.dependOn(&run_tests_cmd.step);
+
+    // The corpus format is only used by the POSIX benchmark tools.
+    if (target.result.os.tag != .windows) {
+        const corpus_tests_module = b.createModule(.{
+            .target = target,
+            .optimize = optimize,
+            .link_libc = true,
+            .sanitize_c = sanitize_c,
+        });
+        corpus_tests_module.addIncludePath(b.path("include"));
+        corpus_tests_module.addIncludePath(b.path("bench"));
+        corpus_tests_module.addCSourceFiles(.{
+            .files = &.{ "tests/parg_corpus_tests.c", "bench/parg_corpus.c" },
+            .flags = c_flags,
+        });
+        corpus_tests_module.linkLibrary(lib);
+
+        const corpus_tests_exe = b.addExecutable(.{
+            .name = "parg-corpus-tests",
+            .root_module = corpus_tests_module,
+        });
+
+        test_step.dependOn(&b.addRunArtifact(corpus_tests_exe).step);
+    }
+
+    const freestanding_lib = b.addLibrary(.{
+        .name = "parg-freestanding",
+        .root_module = createPargModule(b, target, optimize, true),
+        .linkage = .static,
+    });
+
+    const freestanding_tests_module = b.createModule(.{
+        .target = target,
+        .optimize = optimize,
+        .link_libc = true,
+        .sanitize_c = sanitize_c,
+    });
+    freestanding_tests_module.addIncludePath(b.path("include"));
+    freestanding_tests_module.addCSourceFile(.{
+        .file = b.path("tests/parg_tests.c"),
+        .flags = c_flags,
+    });
+    freestanding_tests_module.linkLibrary(freestanding_lib);
+
+    const freestanding_tests_exe = b.addExecutable(.{
+        .name = "parg-tests-freestanding",
+        .root_module = freestanding_tests_module,
+    });
+
+    const objsize_module = b.createModule(.{
+        .target = b.graph.host,
+        .optimize = .ReleaseSafe,
+        .link_libc = true,
+    });
+    objsize_module.addCSourceFile(.{
+        .file = b.path("tools/objsize.c"),
+        .flags = c_flags,
+    });
+
+    const objsize_exe = b.addExecutable(.{
+        .name = "objsize",
+        .root_module = objsize_module,
+    });
+
+    // Build the freestanding object for a bare-metal target so it is ELF,
+    // and fail if it references anything beyond what the compiler may emit.
+    const freestanding_target = b.resolveTargetQuery(.{
+        .cpu_arch = target.result.cpu.arch,
+        .os_tag = .freestanding,
+        .abi = .none,
+    });
+    const freestanding_obj = b.addObject(.{
+        .name = "parg-freestanding",
+        .root_module = createPargModule(b, freestanding_target, optimize, true),
+    });
+
+    const check_freestanding_cmd = b.addRunArtifact(objsize_exe);
+    check_freestanding_cmd.addArg("--allow-undefined=memset,memcpy");
+    check_freestanding_cmd.addArg("freestanding");
+    check_freestanding_cmd.addFileArg(freestanding_obj.getEmittedBin());
+
+    const run_freestanding_tests_cmd = b.addRunArtifact(freestanding_tests_exe);
+    const test_freestanding_step = b.step("test-freestanding", "Run parser regression tests against the libc-free build");
+    test_freestanding_step.dependOn(&check_freestanding_cmd.step);
+    test_freestanding_step.dependOn(&run_freestanding_tests_cmd.step);
+
+    // Benchmarks always use an optimized build so baselines are comparable.
+    const perf_lib = b.addLibrary(.{
+        .name = "parg-perf",
+        .root_module = createPargModule(b, target, .ReleaseFast, false),
+        .linkage = .static,
+    });
+
+    const perf_module = b.createModule(.{
+        .target = target,
+        .optimize = .ReleaseFast,
+        .link_libc = true,
+    });
+    perf_module.addIncludePath(b.path("include"));
+    perf_module.addCSourceFile(.{
+        .file = b.path("bench/parg_perf.c"),
+        .flags = c_flags,
+    });
+    perf_module.linkLibrary(perf_lib);
+
+    const perf_exe = b.addExecutable(.{
+        .name = "parg-perf",
+        .root_module = perf_module,
+    });
+
+    const run_perf_cmd = b.addRunArtifact(perf_exe);
+    run_perf_cmd.has_side_effects = true;
+    if (b.args) |args| {
+        run_perf_cmd.addArgs(args);
+    }
+    b.step("perf", "Run hardware counter benchmarks")
+        .dependOn(&run_perf_cmd.step);
+
+    const replay_module = b.createModule(.{
+        .target = target,
+        .optimize = .ReleaseFast,
+        .link_libc = true,
+    });
+    replay_module.addIncludePath(b.path("include"));
+    replay_module.addIncludePath(b.path("bench"));
+    replay_module.addCSourceFiles(.{
+        .files = &.{ "bench/parg_replay.c", "bench/parg_corpus.c" },
+        .flags = c_flags,
+    });
+    replay_module.linkLibrary(perf_lib);
+
+    const replay_exe = b.addExecutable(.{
+        .name = "parg-replay",
+        .root_module = replay_module,
+    });
+
+    const run_replay_cmd = b.addRunArtifact(replay_exe);
+    run_replay_cmd.has_side_effects = true;
+    if (b.args) |args| {
+        run_replay_cmd.addArgs(args);
+    }
+    b.step("replay", "Replay a recorded argv corpus and report throughput")
+        .dependOn(&run_replay_cmd.step);
+
+    // Report the footprint of src/parg.c in each configuration.
+    const hosted_obj = b.addObject(.{
+        .name = "parg-hosted",
+        .root_module = createPargModule(b, target, optimize, false),
+    });
+    const size_configs = [_]struct {
+        name: []const u8,
+        obj: *std.Build.Step.Compile,
+    }{
+        .{ .name = "hosted", .obj = hosted_obj },
+        .{ .name = "freestanding", .obj = freestanding_obj },
+    };
+
+    const size_cmd = b.addRunArtifact(objsize_exe);
+    size_cmd.has_side_effects = true;
+    for (size_configs) |config| {
+        size_cmd.addArg(config.name);
+        size_cmd.addFileArg(config.obj.getEmittedBin());
+    }
+    b.step("size", "Report code and data size of each library configuration")
+        .dependOn(&size_cmd.step);
 }
@@ -90,7 +90,13 @@ int main(int argc, char **argv) {
         fprintf(stderr, "Unknown option: -%c\n", ps.optopt);
       } else {
         const char *token = ps.optind > 0 ? argv[ps.optind - 1] : "(unknown)";
+        struct parg_suggestion hint[1];
         fprintf(stderr, "Unknown or ambiguous option: %s\n", token);
+        if (token[0] == '-' && token[1] == '-' &&
+            parg_suggest(token + 2, longopts, 2, hint, 1) == 1) {
+          fprintf(stderr, "Did you mean --%s?\n",
+                  longopts[hint[0].index].name);
+        }
       }
       return 1;
     case ':': {
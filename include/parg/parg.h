@@ -24,6 +24,10 @@
 #ifndef PARG_H_INCLUDED
 #define PARG_H_INCLUDED
 
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+
 static constexpr int PARG_VER_MAJOR = 1; /**< Major version number */
 static constexpr int PARG_VER_MINOR = 0; /**< Minor version number */
 static constexpr int PARG_VER_PATCH = 3; /**< Patch version number */
@@ -65,6 +69,202 @@ struct parg_option {
   int val;              /**< Value of option */
 };
 
+/**
+ * Kinds of relationship expressed by `parg_constraint`.
+ *
+ * @see parg_constraint
+ */
+typedef enum {
+  PARG_EXCLUSIVE, /**< At most one of `others` may be given */
+  PARG_REQUIRES,  /**< `option` requires every option in `others` */
+  PARG_CONFLICTS  /**< `option` may not be given with any of `others` */
+} parg_constraint_kind;
+
+/**
+ * Structure for supplying option constraints to `parg_constraints_compile()`.
+ *
+ * Options are identified by their index in the `longopts` array. `others`
+ * points to a list of indices terminated by `-1`. `option` is ignored for
+ * `PARG_EXCLUSIVE`.
+ *
+ * The array of constraints is terminated by an entry where `others` is
+ * `nullptr`.
+ *
+ * @see parg_constraints_compile
+ */
+struct parg_constraint {
+  parg_constraint_kind kind; /**< Kind of constraint */
+  int option;                /**< Index of constrained option */
+  const int *others;         /**< List of option indices, ends with `-1` */
+};
+
+/**
+ * Number of 64-bit words needed for a bitset of `n` options.
+ */
+#define PARG_BITSET_WORDS(n) (((n) + 63) / 64)
+
+/**
+ * Structure containing constraints compiled into bitmasks.
+ *
+ * @see parg_constraints_compile
+ */
+struct parg_constraint_set {
+  const struct parg_constraint *constraints; /**< Source constraints */
+  uint64_t *masks;                 /**< `num_words` words per constraint */
+  int num_options;                 /**< Number of entries in `longopts` */
+  int num_words;                   /**< Words per bitset */
+  int num_constraints;             /**< Number of constraints */
+  int short_index[UCHAR_MAX + 1];  /**< Option index by short option or -1 */
+};
+
+/**
+ * Structure recording which options were seen while parsing.
+ *
+ * Both arrays are supplied by the caller and initialized by
+ * `parg_seen_init()`.
+ *
+ * @see parg_seen_init
+ */
+struct parg_seen {
+  uint64_t *bits; /**< Bitset of seen options, `num_words` words */
+  int *argind;    /**< Index in argv each option was first seen, or -1 */
+};
+
+/**
+ * Structure describing a constraint violation.
+ *
+ * @see parg_constraints_check
+ */
+struct parg_constraint_error {
+  int constraint; /**< Index of violated constraint */
+  int option;     /**< Index of offending option */
+  int other;      /**< Index of conflicting or missing option */
+  int optind;     /**< Index in argv of `option` */
+  int otherind;   /**< Index in argv of `other`, or -1 if missing */
+};
+
+/**
+ * Structure for returning long option suggestions from `parg_suggest()`.
+ *
+ * @see parg_suggest
+ */
+struct parg_suggestion {
+  int index;    /**< Index of suggested option in `longopts` */
+  int distance; /**< Edit distance from unmatched name */
+};
+
+/**
+ * Define an option table checked at compile time.
+ *
+ * `list` is the name of a function-like macro taking one argument, `X`, and
+ * expanding to one `X(tag, id, name, val, kind)` per option, where:
+ *
+ * - `tag` is `SHORT`, `LONG` or `BOTH`, selecting whether the option has a
+ *   short form, a long form, or both
+ * - `id` is an identifier for the option, unique within the table
+ * - `name` is the long option name (ignored for `SHORT`)
+ * - `val` is the value returned for the option, which must be the option
+ *   character for `SHORT` and `BOTH`, in the range 2 to `CHAR_MAX`
+ * - `kind` is `NOARG`, `REQARG` or `OPTARG`
+ *
+ * For example:
+ *
+ *     #define TOOL_OPTIONS(X)                       \
+ *       X(BOTH, help, "help", 'h', NOARG)           \
+ *       X(BOTH, output, "output", 'o', REQARG)      \
+ *       X(SHORT, verbose, nullptr, 'v', NOARG)      \
+ *       X(LONG, dry_run, "dry-run", 256, NOARG)
+ *
+ *     PARG_DEFINE_OPTIONS(tool, TOOL_OPTIONS, ':');
+ *
+ * defines `tool_optstring` as `":ho:v"` and `tool_longopts` with entries for
+ * `help`, `output` and `dry_run`, ready to pass to `parg_getopt_long()`.
+ * Any arguments after `list` are characters placed at the start of the
+ * optstring.
+ *
+ * Since both are generated from the same list, the optstring and long
+ * options always agree on option arguments. Duplicate `id`s, duplicate
+ * `val`s, and values that collide with parser return values fail to
+ * compile. C23 cannot compare string contents in constant expressions, so
+ * duplicate long names are not detected.
+ *
+ * Must be used at file scope.
+ *
+ * @see PARG_LONGINDEX
+ */
+#define PARG_DEFINE_OPTIONS(prefix, list, ...)                                 \
+  list(PARG_TABLE_CHECK_)                                                      \
+  struct prefix##_ids {                                                        \
+    list(PARG_TABLE_ID_) char parg_end_;                                       \
+  };                                                                           \
+  struct prefix##_longindex {                                                  \
+    list(PARG_TABLE_MEMBER_) char parg_end_;                                   \
+  };                                                                           \
+  [[maybe_unused]] static constexpr char prefix##_optstring[] = {             \
+      __VA_ARGS__ __VA_OPT__(, ) list(PARG_TABLE_OPTSTR_) '\0'};               \
+  [[maybe_unused]] static const struct parg_option prefix##_longopts[] = {     \
+      list(PARG_TABLE_LONGOPT_){nullptr, PARG_NOARG, nullptr, 0}};            \
+  [[maybe_unused]] static inline void prefix##_check_unique_vals(int c) {      \
+    switch (c) {                                                               \
+      list(PARG_TABLE_CASE_) default : break;                                  \
+    }                                                                          \
+  }                                                                            \
+  static_assert(sizeof(prefix##_longopts) / sizeof(prefix##_longopts[0]) ==    \
+                PARG_NUM_LONGOPTS(prefix) + 1)
+
+/**
+ * Index in `longopts` of option `id` in a table defined by
+ * `PARG_DEFINE_OPTIONS()`, as an integer constant expression.
+ */
+#define PARG_LONGINDEX(prefix, id)                                             \
+  ((int)offsetof(struct prefix##_longindex, id))
+
+/**
+ * Number of long options in a table defined by `PARG_DEFINE_OPTIONS()`, as
+ * an integer constant expression.
+ */
+#define PARG_NUM_LONGOPTS(prefix)                                              \
+  ((int)offsetof(struct prefix##_longindex, parg_end_))
+
+/* Helpers for PARG_DEFINE_OPTIONS, dispatching on tag */
+#define PARG_TABLE_ARGCHARS_NOARG
+#define PARG_TABLE_ARGCHARS_REQARG ':',
+#define PARG_TABLE_ARGCHARS_OPTARG ':', ':',
+
+#define PARG_TABLE_CHECK_(tag, id, name, val, kind)                            \
+  PARG_TABLE_CHECK_##tag(id, val)
+#define PARG_TABLE_CHECK_SHORT(id, val)                                        \
+  static_assert((val) > 1 && (val) <= CHAR_MAX && (val) != '-' &&             \
+                    (val) != ':' && (val) != '?',                              \
+                "invalid short option character for " #id);
+#define PARG_TABLE_CHECK_BOTH PARG_TABLE_CHECK_SHORT
+#define PARG_TABLE_CHECK_LONG(id, val)                                         \
+  static_assert((val) != -1 && (val) != 0 && (val) != 1 && (val) != ':' &&    \
+                    (val) != '?',                                              \
+                "invalid long option value for " #id);
+
+#define PARG_TABLE_ID_(tag, id, name, val, kind) char id;
+
+#define PARG_TABLE_MEMBER_(tag, id, name, val, kind) PARG_TABLE_MEMBER_##tag(id)
+#define PARG_TABLE_MEMBER_SHORT(id)
+#define PARG_TABLE_MEMBER_BOTH(id) char id;
+#define PARG_TABLE_MEMBER_LONG(id) char id;
+
+#define PARG_TABLE_OPTSTR_(tag, id, name, val, kind)                           \
+  PARG_TABLE_OPTSTR_##tag(val, kind)
+#define PARG_TABLE_OPTSTR_SHORT(val, kind) val, PARG_TABLE_ARGCHARS_##kind
+#define PARG_TABLE_OPTSTR_BOTH PARG_TABLE_OPTSTR_SHORT
+#define PARG_TABLE_OPTSTR_LONG(val, kind)
+
+#define PARG_TABLE_LONGOPT_(tag, id, name, val, kind)                          \
+  PARG_TABLE_LONGOPT_##tag(name, val, kind)
+#define PARG_TABLE_LONGOPT_SHORT(name, val, kind)
+#define PARG_TABLE_LONGOPT_BOTH(name, val, kind)                               \
+  {name, PARG_##kind, nullptr, val},
+#define PARG_TABLE_LONGOPT_LONG PARG_TABLE_LONGOPT_BOTH
+
+#define PARG_TABLE_CASE_(tag, id, name, val, kind) case (val):
+
 /**
  * Initialize `ps`.
  *
@@ -190,4 +390,99 @@ void parg_init(struct parg_state *ps);
 [[nodiscard]] int parg_reorder(int argc, char *argv[], const char *optstring,
                                const struct parg_option *longopts);
 
+/**
+ * Compile `constraints` on the options in `longopts` into `cs`.
+ *
+ * `masks` must have room for `PARG_BITSET_WORDS(n)` words per constraint,
+ * where `n` is the number of entries in `longopts`. `cs` keeps pointers to
+ * `constraints` and `masks`, which must outlive it.
+ *
+ * Short options are mapped to the first entry in `longopts` with a matching
+ * `val` and no `flag`, so constraints apply to both spellings.
+ *
+ * @param cs pointer to constraint set
+ * @param longopts array of `parg_option` structures
+ * @param constraints array of `parg_constraint` structures
+ * @param masks storage for compiled bitmasks
+ * @return `0` on success, `-1` if a constraint refers to an invalid index
+ */
+[[nodiscard]] int parg_constraints_compile(
+    struct parg_constraint_set *cs, const struct parg_option *longopts,
+    const struct parg_constraint *constraints, uint64_t *masks);
+
+/**
+ * Initialize `seen` to record no options.
+ *
+ * `seen->bits` must have room for `cs->num_words` words, and
+ * `seen->argind` for `cs->num_options` elements.
+ *
+ * @param cs pointer to constraint set
+ * @param seen pointer to seen options
+ */
+void parg_seen_init(const struct parg_constraint_set *cs,
+                    struct parg_seen *seen);
+
+/**
+ * Record the option just returned by `parg_getopt_long()` in `seen`.
+ *
+ * `c` and `longindex` are the return value and long index from the call.
+ * Nonoptions, errors, and options without an entry in `longopts` are
+ * ignored.
+ *
+ * @param cs pointer to constraint set
+ * @param seen pointer to seen options
+ * @param ps pointer to state used for the call
+ * @param argv array of pointers to command-line arguments
+ * @param c value returned by `parg_getopt_long()`
+ * @param longindex long index stored by `parg_getopt_long()`
+ */
+void parg_seen_record(const struct parg_constraint_set *cs,
+                      struct parg_seen *seen, const struct parg_state *ps,
+                      char *const argv[], int c, int longindex);
+
+/**
+ * Check options in `seen` against the constraints in `cs`.
+ *
+ * Constraints are checked starting with index `first`. On the first
+ * violation found, `err` is filled in and the index of the constraint is
+ * returned. Calling again with `first` set to one past that index continues
+ * the check.
+ *
+ * For `PARG_EXCLUSIVE`, `option` and `other` are the first two of the
+ * options given, in the order they appear in argv.
+ *
+ * @param cs pointer to constraint set
+ * @param seen pointer to seen options
+ * @param first index of first constraint to check
+ * @param err pointer to error information
+ * @return index of violated constraint, `-1` if all constraints hold
+ */
+[[nodiscard]] int parg_constraints_check(const struct parg_constraint_set *cs,
+                                         const struct parg_seen *seen,
+                                         int first,
+                                         struct parg_constraint_error *err);
+
+/**
+ * Suggest long options close to an unmatched name.
+ *
+ * Intended for use when `parg_getopt_long()` returns '`?`' with `optopt` set
+ * to `0`, in which case the name is at `argv[ps->optind - 1] + 2`. Any
+ * option argument following an equal sign in `name` is ignored.
+ *
+ * Up to `max_out` entries in `longopts` whose Levenshtein distance to `name`
+ * is at most `max_dist` are stored in `out`, ordered by distance and then by
+ * index. Names longer than 64 characters get no suggestions.
+ *
+ * @param name unmatched long option name, without leading dashes
+ * @param longopts array of `parg_option` structures
+ * @param max_dist maximum edit distance of suggestions
+ * @param out array of `parg_suggestion` structures to store suggestions in
+ * @param max_out number of elements in `out`
+ * @return number of suggestions stored in `out`
+ */
+[[nodiscard]] int parg_suggest(const char *name,
+                               const struct parg_option *longopts,
+                               int max_dist, struct parg_suggestion *out,
+                               int max_out);
+
 #endif /* PARG_H_INCLUDED */
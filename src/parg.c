@@ -21,12 +21,69 @@
  * SPDX-License-Identifier: MIT-0
  */
 
-#include <assert.h>
+#include <limits.h>
 #include <stddef.h>
-#include <string.h>
+#include <stdint.h>
 
 #include "parg/parg.h"
 
+#ifdef PARG_FREESTANDING
+/*
+ * Without a C library, supply the few string functions needed here and
+ * compile out assertions.
+ */
+#define assert(expr) ((void)0)
+
+static const char *parg_strchr(const char *s, int c) {
+  for (;; ++s) {
+    if (*s == (char)c) {
+      return s;
+    }
+    if (*s == '\0') {
+      return nullptr;
+    }
+  }
+}
+
+static size_t parg_strcspn(const char *s, const char *reject) {
+  size_t i = 0;
+
+  while (s[i] != '\0' && parg_strchr(reject, s[i]) == nullptr) {
+    ++i;
+  }
+
+  return i;
+}
+
+static int parg_strncmp(const char *s1, const char *s2, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if (s1[i] != s2[i] || s1[i] == '\0') {
+      return (unsigned char)s1[i] - (unsigned char)s2[i];
+    }
+  }
+
+  return 0;
+}
+
+static size_t parg_strlen(const char *s) {
+  size_t i = 0;
+
+  while (s[i] != '\0') {
+    ++i;
+  }
+
+  return i;
+}
+#else
+#include <assert.h>
+#include <string.h>
+
+#define parg_strchr strchr
+#define parg_strcspn strcspn
+#define parg_strncmp strncmp
+#define parg_strlen strlen
+#endif
+
 /* Check if state is at end of argv. */
 static bool is_argv_end(const struct parg_state *ps, int argc,
                         char *const argv[]) {
@@ -38,7 +95,7 @@ static bool is_argv_end(const struct parg_state *ps, int argc,
  */
 static int match_short(struct parg_state *ps, int argc, char *const argv[],
                        const char *optstring) {
-  const char *p = strchr(optstring, *ps->nextchar);
+  const char *p = parg_strchr(optstring, *ps->nextchar);
 
   if (p == nullptr) {
     ps->optopt = *ps->nextchar++;
@@ -79,12 +136,12 @@ static int match_short(struct parg_state *ps, int argc, char *const argv[],
 static int match_long(struct parg_state *ps, int argc, char *const argv[],
                       const char *optstring, const struct parg_option *longopts,
                       int *longindex) {
-  size_t len = strcspn(ps->nextchar, "=");
+  size_t len = parg_strcspn(ps->nextchar, "=");
   int num_match = 0;
   int match = -1;
 
   for (int i = 0; longopts[i].name != nullptr; ++i) {
-    if (strncmp(ps->nextchar, longopts[i].name, len) == 0) {
+    if (parg_strncmp(ps->nextchar, longopts[i].name, len) == 0) {
       match = i;
       num_match++;
       /* Take if exact match */
@@ -337,3 +394,323 @@ int parg_reorder(int argc, char *argv[], const char *optstring,
 
   return optend;
 }
+
+/*
+ * Find index of lowest set bit in `w`, which must be nonzero.
+ */
+static int lowest_bit(uint64_t w) {
+  assert(w != 0);
+
+#if defined(__GNUC__)
+  return __builtin_ctzll(w);
+#else
+  /* Isolate lowest bit and look up its position with a de Bruijn sequence */
+  static const unsigned char table[64] = {
+      0,  1,  2,  53, 3,  7,  54, 27, 4,  38, 41, 8,  34, 55, 48, 28,
+      62, 5,  39, 46, 44, 42, 22, 9,  24, 35, 59, 56, 49, 18, 29, 11,
+      63, 52, 6,  26, 37, 40, 33, 47, 61, 45, 43, 21, 23, 58, 17, 10,
+      51, 25, 36, 32, 60, 20, 57, 16, 50, 31, 19, 15, 30, 14, 13, 12,
+  };
+
+  return table[((w & -w) * UINT64_C(0x022fdd63cc95386d)) >> 58];
+#endif
+}
+
+int parg_constraints_compile(struct parg_constraint_set *cs,
+                             const struct parg_option *longopts,
+                             const struct parg_constraint *constraints,
+                             uint64_t *masks) {
+  int num_options = 0;
+
+  assert(cs != nullptr);
+  assert(longopts != nullptr);
+  assert(constraints != nullptr);
+
+  for (int c = 0; c <= UCHAR_MAX; ++c) {
+    cs->short_index[c] = -1;
+  }
+
+  for (; longopts[num_options].name != nullptr; ++num_options) {
+    const struct parg_option *opt = &longopts[num_options];
+
+    /* Map short option with same value to first matching entry */
+    if (opt->flag == nullptr && opt->val > 0 && opt->val <= UCHAR_MAX &&
+        cs->short_index[opt->val] == -1) {
+      cs->short_index[opt->val] = num_options;
+    }
+  }
+
+  cs->constraints = constraints;
+  cs->masks = masks;
+  cs->num_options = num_options;
+  cs->num_words = PARG_BITSET_WORDS(num_options);
+  cs->num_constraints = 0;
+
+  for (int i = 0; constraints[i].others != nullptr; ++i) {
+    uint64_t *mask = &masks[i * cs->num_words];
+
+    if (constraints[i].kind != PARG_EXCLUSIVE &&
+        (constraints[i].option < 0 || constraints[i].option >= num_options)) {
+      return -1;
+    }
+
+    for (int w = 0; w < cs->num_words; ++w) {
+      mask[w] = 0;
+    }
+
+    for (const int *p = constraints[i].others; *p != -1; ++p) {
+      if (*p < 0 || *p >= num_options) {
+        return -1;
+      }
+
+      mask[*p / 64] |= UINT64_C(1) << (*p % 64);
+    }
+
+    cs->num_constraints = i + 1;
+  }
+
+  return 0;
+}
+
+void parg_seen_init(const struct parg_constraint_set *cs,
+                    struct parg_seen *seen) {
+  assert(cs != nullptr);
+  assert(seen != nullptr);
+
+  for (int w = 0; w < cs->num_words; ++w) {
+    seen->bits[w] = 0;
+  }
+
+  for (int i = 0; i < cs->num_options; ++i) {
+    seen->argind[i] = -1;
+  }
+}
+
+void parg_seen_record(const struct parg_constraint_set *cs,
+                      struct parg_seen *seen, const struct parg_state *ps,
+                      char *const argv[], int c, int longindex) {
+  int argind = ps->optind - 1;
+  int index;
+
+  assert(cs != nullptr);
+  assert(seen != nullptr);
+  assert(ps != nullptr);
+  assert(argv != nullptr);
+
+  if (c == 1 || c == -1 || c == '?' || c == ':' || argind < 1) {
+    return;
+  }
+
+  /* Step back over option argument taken from separate element */
+  if (ps->nextchar == nullptr && ps->optarg != nullptr &&
+      ps->optarg == argv[argind]) {
+    --argind;
+  }
+
+  if (argv[argind][0] == '-' && argv[argind][1] == '-') {
+    index = longindex;
+  } else if (c > 0 && c <= UCHAR_MAX) {
+    index = cs->short_index[c];
+  } else {
+    return;
+  }
+
+  if (index < 0 || index >= cs->num_options) {
+    return;
+  }
+
+  if (seen->argind[index] == -1) {
+    seen->argind[index] = argind;
+  }
+
+  seen->bits[index / 64] |= UINT64_C(1) << (index % 64);
+}
+
+int parg_constraints_check(const struct parg_constraint_set *cs,
+                           const struct parg_seen *seen, int first,
+                           struct parg_constraint_error *err) {
+  assert(cs != nullptr);
+  assert(seen != nullptr);
+  assert(err != nullptr);
+
+  for (int i = first < 0 ? 0 : first; i < cs->num_constraints; ++i) {
+    const struct parg_constraint *con = &cs->constraints[i];
+    const uint64_t *mask = &cs->masks[i * cs->num_words];
+    int option = -1;
+    int other = -1;
+
+    if (con->kind == PARG_EXCLUSIVE) {
+      /* Take the two options seen first in argv */
+      for (int w = 0; w < cs->num_words; ++w) {
+        uint64_t hit = seen->bits[w] & mask[w];
+
+        while (hit != 0) {
+          const int bit = w * 64 + lowest_bit(hit);
+
+          if (option == -1 || seen->argind[bit] < seen->argind[option]) {
+            other = option;
+            option = bit;
+          } else if (other == -1 ||
+                     seen->argind[bit] < seen->argind[other]) {
+            other = bit;
+          }
+
+          hit &= hit - 1;
+        }
+      }
+    } else {
+      const int subject = con->option;
+
+      if ((seen->bits[subject / 64] & (UINT64_C(1) << (subject % 64))) == 0) {
+        continue;
+      }
+
+      option = subject;
+
+      for (int w = 0; w < cs->num_words && other == -1; ++w) {
+        const uint64_t hit = seen->bits[w] & mask[w];
+
+        switch (con->kind) {
+        case PARG_REQUIRES:
+          if (hit != mask[w]) {
+            other = w * 64 + lowest_bit(mask[w] & ~hit);
+          }
+          break;
+        case PARG_CONFLICTS:
+          if (hit != 0) {
+            other = w * 64 + lowest_bit(hit);
+          }
+          break;
+        case PARG_EXCLUSIVE:
+          break;
+        }
+      }
+    }
+
+    if (other != -1) {
+      err->constraint = i;
+      err->option = option;
+      err->other = other;
+      err->optind = seen->argind[option];
+      err->otherind = seen->argind[other];
+      return i;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Compute edit distance between pattern and `text` using the bit-parallel
+ * algorithm by Myers, as formulated by Hyyro.
+ *
+ * `peq` holds, for each character, the bitmask of its positions in the
+ * pattern. The first `shift` characters of the pattern are skipped, and
+ * the remaining `m` (1 to 64) are used. Returns a value greater than
+ * `max_dist` as soon as the distance is known to exceed it.
+ */
+static int myers_distance(const uint64_t peq[], int shift, int m,
+                          const char *text, int n, int max_dist) {
+  const uint64_t last = UINT64_C(1) << (m - 1);
+  uint64_t pv = ~UINT64_C(0);
+  uint64_t mv = 0;
+  int score = m;
+
+  for (int j = 0; j < n; ++j) {
+    const uint64_t eq = peq[(unsigned char)text[j]] >> shift;
+    const uint64_t xv = eq | mv;
+    const uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+    uint64_t ph = mv | ~(xh | pv);
+    uint64_t mh = pv & xh;
+
+    if (ph & last) {
+      ++score;
+    } else if (mh & last) {
+      --score;
+    }
+
+    /* Remaining characters can lower the score by at most one each */
+    if (score - (n - j - 1) > max_dist) {
+      return max_dist + 1;
+    }
+
+    ph = (ph << 1) | 1;
+    mh <<= 1;
+    pv = mh | ~(xv | ph);
+    mv = ph & xv;
+  }
+
+  return score;
+}
+
+int parg_suggest(const char *name, const struct parg_option *longopts,
+                 int max_dist, struct parg_suggestion *out, int max_out) {
+  uint64_t peq[UCHAR_MAX + 1] = {0};
+  int num_out = 0;
+  int len;
+
+  assert(name != nullptr);
+  assert(longopts != nullptr);
+  assert(out != nullptr || max_out <= 0);
+
+  len = (int)parg_strcspn(name, "=");
+
+  if (len > 64 || max_dist < 0 || max_out <= 0) {
+    return 0;
+  }
+
+  for (int i = 0; i < len; ++i) {
+    peq[(unsigned char)name[i]] |= UINT64_C(1) << i;
+  }
+
+  for (int i = 0; longopts[i].name != nullptr; ++i) {
+    const char *cand = longopts[i].name;
+    const int cap =
+        num_out == max_out ? out[num_out - 1].distance - 1 : max_dist;
+    int prefix = 0;
+    int cand_len;
+    int dist;
+    int pos;
+
+    /* Stop once no candidate can beat the suggestions found */
+    if (cap < 0) {
+      break;
+    }
+
+    /* Skip common prefix, which does not change the distance */
+    while (prefix < len && cand[prefix] == name[prefix]) {
+      ++prefix;
+    }
+
+    cand_len = prefix + (int)parg_strlen(&cand[prefix]);
+
+    /* Distance is at least the difference in length */
+    if (cand_len - len > cap || len - cand_len > cap) {
+      continue;
+    }
+
+    if (prefix == len) {
+      dist = cand_len - len;
+    } else {
+      dist = myers_distance(peq, prefix, len - prefix, &cand[prefix],
+                            cand_len - prefix, cap);
+    }
+
+    if (dist > cap) {
+      continue;
+    }
+
+    /* Insert sorted by distance, keeping earlier entries first on ties */
+    pos = num_out < max_out ? num_out++ : max_out - 1;
+
+    while (pos > 0 && out[pos - 1].distance > dist) {
+      out[pos] = out[pos - 1];
+      --pos;
+    }
+
+    out[pos].index = i;
+    out[pos].distance = dist;
+  }
+
+  return num_out;
+}
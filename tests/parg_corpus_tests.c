@@ -0,0 +1,265 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "parg_corpus.h"
+
+#define ASSERT_EQ_INT(actual, expected)                                        \
+  do {                                                                         \
+    if ((actual) != (expected)) {                                              \
+      fprintf(stderr,                                                          \
+              "assert failed: %s == %s (actual=%d expected=%d) at %s:%d\n",    \
+              #actual, #expected, (actual), (expected), __FILE__, __LINE__);   \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define ASSERT_EQ_STR(actual, expected)                                        \
+  do {                                                                         \
+    if (strcmp((actual), (expected)) != 0) {                                   \
+      fprintf(stderr,                                                          \
+              "assert failed: %s == %s (actual=%s expected=%s) at %s:%d\n",    \
+              #actual, #expected, (actual), (expected), __FILE__, __LINE__);   \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+static int color;
+
+static const struct parg_option longopts[] = {
+    {"verbose", PARG_NOARG, nullptr, 'v'},
+    {"output", PARG_REQARG, nullptr, 'o'},
+    {"color", PARG_NOARG, &color, 1},
+    {nullptr, PARG_NOARG, nullptr, 0},
+};
+
+static char arg0[] = "prog";
+static char arg_v[] = "-v";
+static char arg_color[] = "--color";
+static char arg_output[] = "--output=out";
+static char arg_dashdash[] = "--";
+static char arg_file[] = "file";
+static char arg_o[] = "-o";
+static char arg_x[] = "-x";
+
+static char *argv_dashdash[] = {arg0,       arg_v,        arg_color,
+                                arg_output, arg_dashdash, arg_v,
+                                nullptr};
+static char *argv_mixed[] = {arg0, arg_file, arg_o, arg_file, arg_v, nullptr};
+static char *argv_other[] = {arg0, arg_x, arg_file, nullptr};
+static char *argv_empty[] = {nullptr};
+
+static unsigned char *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  unsigned char *buf = nullptr;
+  long len;
+
+  if (f == nullptr) {
+    return nullptr;
+  }
+
+  if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 &&
+      fseek(f, 0, SEEK_SET) == 0) {
+    buf = malloc((size_t)len);
+
+    if (buf != nullptr && fread(buf, 1, (size_t)len, f) != (size_t)len) {
+      free(buf);
+      buf = nullptr;
+    }
+
+    *size = (size_t)len;
+  }
+
+  fclose(f);
+  return buf;
+}
+
+static int check_entry(const struct parg_corpus *cp, int i, int argc,
+                       char *const argv[], const char *optstring,
+                       const struct parg_option *opts) {
+  const struct parg_corpus_entry *e = &cp->entries[i];
+  const struct parg_corpus_table *t = &cp->tables[e->table];
+  struct parg_corpus_expect want;
+  struct parg_corpus_expect got;
+
+  ASSERT_EQ_STR(t->optstring, optstring);
+  ASSERT_EQ_INT(e->argc, argc);
+
+  for (int j = 0; j < argc; ++j) {
+    ASSERT_EQ_STR(e->argv[j], argv[j]);
+  }
+
+  ASSERT_EQ_INT(e->argv[argc] == nullptr, 1);
+
+  ASSERT_EQ_INT(
+      parg_corpus_compute_expect(argc, argv, optstring, opts, &want), 0);
+  ASSERT_EQ_INT(parg_corpus_compute_expect(e->argc, e->argv, t->optstring,
+                                           t->longopts, &got),
+                0);
+
+  ASSERT_EQ_INT(e->expect.optend, want.optend);
+  ASSERT_EQ_INT(e->expect.parse_digest == want.parse_digest, 1);
+  ASSERT_EQ_INT(e->expect.reorder_digest == want.reorder_digest, 1);
+  ASSERT_EQ_INT(got.optend, want.optend);
+  ASSERT_EQ_INT(got.parse_digest == want.parse_digest, 1);
+  ASSERT_EQ_INT(got.reorder_digest == want.reorder_digest, 1);
+  return 0;
+}
+
+static int test_capture_round_trip(const char *path) {
+  struct parg_corpus cp = {0};
+  unsigned char *data;
+  size_t size = 0;
+
+  ASSERT_EQ_INT(
+      parg_corpus_capture(path, 6, argv_dashdash, ":vo:", longopts), 0);
+  ASSERT_EQ_INT(parg_corpus_capture(path, 5, argv_mixed, ":vo:", longopts),
+                0);
+  ASSERT_EQ_INT(parg_corpus_capture(path, 3, argv_other, "x", nullptr), 0);
+  ASSERT_EQ_INT(parg_corpus_capture(path, 0, argv_empty, ":vo:", longopts),
+                0);
+
+  /* Capturing does not parse into the caller's flags */
+  ASSERT_EQ_INT(color, 0);
+
+  data = read_file(path, &size);
+  ASSERT_EQ_INT(data != nullptr, 1);
+  ASSERT_EQ_INT(parg_corpus_load(&cp, data, size), 0);
+
+  ASSERT_EQ_INT(cp.num_tables, 2);
+  ASSERT_EQ_INT(cp.num_entries, 4);
+  ASSERT_EQ_INT((int)cp.num_args, 5 + 4 + 2);
+  ASSERT_EQ_INT((int)cp.skipped, 0);
+  ASSERT_EQ_INT(cp.max_argc, 6);
+
+  ASSERT_EQ_INT(cp.tables[0].id == parg_corpus_table_id(":vo:", longopts), 1);
+  ASSERT_EQ_INT(cp.tables[1].id == parg_corpus_table_id("x", nullptr), 1);
+  ASSERT_EQ_STR(cp.tables[0].longopts[2].name, "color");
+  ASSERT_EQ_INT(cp.tables[0].longopts[2].flag != nullptr, 1);
+  ASSERT_EQ_INT(cp.tables[0].longopts[3].name == nullptr, 1);
+  ASSERT_EQ_INT(cp.tables[1].longopts[0].name == nullptr, 1);
+
+  ASSERT_EQ_INT(check_entry(&cp, 0, 6, argv_dashdash, ":vo:", longopts), 0);
+  ASSERT_EQ_INT(check_entry(&cp, 1, 5, argv_mixed, ":vo:", longopts), 0);
+  ASSERT_EQ_INT(check_entry(&cp, 2, 3, argv_other, "x", nullptr), 0);
+  ASSERT_EQ_INT(check_entry(&cp, 3, 0, argv_empty, ":vo:", longopts), 0);
+
+  parg_corpus_free(&cp);
+  free(data);
+  return 0;
+}
+
+static int test_damaged_corpus_rejected(const char *path) {
+  struct parg_corpus cp = {0};
+  unsigned char *data;
+  size_t before = 0;
+  size_t size = 0;
+  int num_entries;
+
+  data = read_file(path, &before);
+  ASSERT_EQ_INT(data != nullptr, 1);
+  ASSERT_EQ_INT(parg_corpus_load(&cp, data, before), 0);
+  num_entries = cp.num_entries;
+  parg_corpus_free(&cp);
+  free(data);
+
+  ASSERT_EQ_INT(parg_corpus_capture(path, 5, argv_mixed, ":vo:", longopts),
+                0);
+
+  data = read_file(path, &size);
+  ASSERT_EQ_INT(data != nullptr, 1);
+  ASSERT_EQ_INT(size > before, 1);
+
+  /* A cut at the record boundary is a valid, shorter corpus */
+  ASSERT_EQ_INT(parg_corpus_load(&cp, data, before), 0);
+  ASSERT_EQ_INT(cp.num_entries, num_entries);
+  parg_corpus_free(&cp);
+
+  for (size_t cut = before + 1; cut < size; ++cut) {
+    ASSERT_EQ_INT(parg_corpus_load(&cp, data, cut), -1);
+    parg_corpus_free(&cp);
+  }
+
+  for (size_t cut = 0; cut < 12; ++cut) {
+    ASSERT_EQ_INT(parg_corpus_load(&cp, data, cut), -1);
+    parg_corpus_free(&cp);
+  }
+
+  /* A trailing length that does not match the header is rejected */
+  data[size - 1] ^= 0xff;
+  ASSERT_EQ_INT(parg_corpus_load(&cp, data, size), -1);
+  parg_corpus_free(&cp);
+  data[size - 1] ^= 0xff;
+
+  /* Capturing to a file with a partial record fails */
+  ASSERT_EQ_INT(truncate(path, (off_t)(size - 1)), 0);
+  ASSERT_EQ_INT(parg_corpus_capture(path, 3, argv_other, "x", nullptr), -1);
+
+  free(data);
+  return 0;
+}
+
+static int test_distant_table_repeated_once_loaded(const char *path) {
+  struct parg_corpus cp = {0};
+  struct stat st;
+  unsigned char *data;
+  size_t size = 0;
+  int num_other = 0;
+
+  /* Push the first table out of the window searched by capture */
+  do {
+    ASSERT_EQ_INT(parg_corpus_capture(path, 3, argv_other, "x", nullptr), 0);
+    ASSERT_EQ_INT(stat(path, &st), 0);
+    ++num_other;
+  } while (st.st_size < 80 * 1024);
+
+  ASSERT_EQ_INT(parg_corpus_capture(path, 5, argv_mixed, ":vo:", longopts),
+                0);
+
+  data = read_file(path, &size);
+  ASSERT_EQ_INT(data != nullptr, 1);
+  ASSERT_EQ_INT(parg_corpus_load(&cp, data, size), 0);
+
+  ASSERT_EQ_INT(cp.num_tables, 2);
+  ASSERT_EQ_INT(cp.num_entries, 4 + num_other + 1);
+  ASSERT_EQ_INT((int)cp.skipped, 0);
+  ASSERT_EQ_INT(check_entry(&cp, cp.num_entries - 1, 5, argv_mixed, ":vo:",
+                            longopts),
+                0);
+
+  parg_corpus_free(&cp);
+  free(data);
+  return 0;
+}
+
+int main() {
+  char path[] = "/tmp/parg_corpus_XXXXXX";
+  const int fd = mkstemp(path);
+  int status = 0;
+
+  if (fd < 0) {
+    perror("mkstemp");
+    return 1;
+  }
+
+  close(fd);
+
+  if (test_capture_round_trip(path) != 0 ||
+      test_distant_table_repeated_once_loaded(path) != 0 ||
+      test_damaged_corpus_rejected(path) != 0) {
+    status = 1;
+  }
+
+  remove(path);
+
+  if (status == 0) {
+    puts("parg corpus tests passed");
+  }
+
+  return status;
+}
@@ -1,3 +1,4 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -23,6 +24,19 @@
     }                                                                          \
   } while (0)
 
+#define TABLE_OPTIONS(X)                                                       \
+  X(BOTH, help, "help", 'h', NOARG)                                            \
+  X(SHORT, verbose, nullptr, 'v', NOARG)                                       \
+  X(BOTH, output, "output", 'o', REQARG)                                       \
+  X(LONG, dry_run, "dry-run", 256, NOARG)                                      \
+  X(BOTH, size, "size", 's', OPTARG)
+
+PARG_DEFINE_OPTIONS(table, TABLE_OPTIONS, ':');
+
+static_assert(PARG_NUM_LONGOPTS(table) == 4);
+static_assert(PARG_LONGINDEX(table, dry_run) == 2);
+static_assert(sizeof(table_optstring) == sizeof(":hvo:s::"));
+
 static int test_unknown_long_sets_optopt_zero() {
   char arg0[] = "prog";
   char arg1[] = "--unknown";
@@ -120,6 +134,183 @@ static int test_reorder_moves_options_first() {
   return 0;
 }
 
+static int test_constraints_report_argv_indices() {
+  char arg0[] = "prog";
+  char arg1[] = "-q";
+  char arg2[] = "input";
+  char arg3[] = "--output";
+  char arg4[] = "out.txt";
+  char arg5[] = "--verbose";
+  char *argv[] = {arg0, arg1, arg2, arg3, arg4, arg5, nullptr};
+  struct parg_state ps;
+  const struct parg_option longopts[] = {
+      {"verbose", PARG_NOARG, nullptr, 'v'},
+      {"quiet", PARG_NOARG, nullptr, 'q'},
+      {"output", PARG_REQARG, nullptr, 'o'},
+      {"format", PARG_REQARG, nullptr, 'f'},
+      {nullptr, PARG_NOARG, nullptr, 0},
+  };
+  const int loud[] = {0, 1, -1};
+  const int needs_format[] = {3, -1};
+  const struct parg_constraint constraints[] = {
+      {PARG_EXCLUSIVE, -1, loud},
+      {PARG_REQUIRES, 2, needs_format},
+      {PARG_EXCLUSIVE, 0, nullptr},
+  };
+  struct parg_constraint_set cs;
+  uint64_t masks[2 * PARG_BITSET_WORDS(4)];
+  uint64_t bits[PARG_BITSET_WORDS(4)];
+  int argind[4];
+  struct parg_seen seen = {bits, argind};
+  struct parg_constraint_error err;
+  int longindex = -1;
+  int c;
+
+  ASSERT_EQ_INT(parg_constraints_compile(&cs, longopts, constraints, masks), 0);
+  ASSERT_EQ_INT(cs.num_constraints, 2);
+  parg_seen_init(&cs, &seen);
+
+  parg_init(&ps);
+  while ((c = parg_getopt_long(&ps, 6, argv, ":vqo:f:", longopts,
+                               &longindex)) != -1) {
+    parg_seen_record(&cs, &seen, &ps, argv, c, longindex);
+  }
+
+  ASSERT_EQ_INT(parg_constraints_check(&cs, &seen, 0, &err), 0);
+  ASSERT_EQ_INT(err.option, 1);
+  ASSERT_EQ_INT(err.other, 0);
+  ASSERT_EQ_INT(err.optind, 1);
+  ASSERT_EQ_INT(err.otherind, 5);
+
+  ASSERT_EQ_INT(parg_constraints_check(&cs, &seen, 1, &err), 1);
+  ASSERT_EQ_INT(err.option, 2);
+  ASSERT_EQ_INT(err.other, 3);
+  ASSERT_EQ_INT(err.optind, 3);
+  ASSERT_EQ_INT(err.otherind, -1);
+
+  ASSERT_EQ_INT(parg_constraints_check(&cs, &seen, 2, &err), -1);
+  return 0;
+}
+
+static int test_constraints_short_cluster_conflicts() {
+  char arg0[] = "prog";
+  char arg1[] = "-vofile";
+  char arg2[] = "-n";
+  char *argv[] = {arg0, arg1, arg2, nullptr};
+  struct parg_state ps;
+  const struct parg_option longopts[] = {
+      {"verbose", PARG_NOARG, nullptr, 'v'},
+      {"output", PARG_REQARG, nullptr, 'o'},
+      {"dry-run", PARG_NOARG, nullptr, 'n'},
+      {nullptr, PARG_NOARG, nullptr, 0},
+  };
+  const int writes[] = {1, -1};
+  const int bad_index[] = {4, -1};
+  const struct parg_constraint constraints[] = {
+      {PARG_CONFLICTS, 2, writes},
+      {PARG_EXCLUSIVE, 0, nullptr},
+  };
+  const struct parg_constraint invalid[] = {
+      {PARG_REQUIRES, 0, bad_index},
+      {PARG_EXCLUSIVE, 0, nullptr},
+  };
+  struct parg_constraint_set cs;
+  uint64_t masks[PARG_BITSET_WORDS(3)];
+  uint64_t bits[PARG_BITSET_WORDS(3)];
+  int argind[3];
+  struct parg_seen seen = {bits, argind};
+  struct parg_constraint_error err;
+  int longindex = -1;
+  int c;
+
+  ASSERT_EQ_INT(parg_constraints_compile(&cs, longopts, invalid, masks), -1);
+  ASSERT_EQ_INT(parg_constraints_compile(&cs, longopts, constraints, masks), 0);
+  parg_seen_init(&cs, &seen);
+
+  parg_init(&ps);
+  while ((c = parg_getopt_long(&ps, 3, argv, "vo:n", longopts,
+                               &longindex)) != -1) {
+    parg_seen_record(&cs, &seen, &ps, argv, c, longindex);
+  }
+
+  ASSERT_EQ_INT(argind[0], 1);
+  ASSERT_EQ_INT(argind[1], 1);
+  ASSERT_EQ_INT(argind[2], 2);
+  ASSERT_EQ_INT(parg_constraints_check(&cs, &seen, 0, &err), 0);
+  ASSERT_EQ_INT(err.option, 2);
+  ASSERT_EQ_INT(err.other, 1);
+  ASSERT_EQ_INT(err.optind, 2);
+  ASSERT_EQ_INT(err.otherind, 1);
+  return 0;
+}
+
+static int test_suggest_orders_by_distance() {
+  char arg0[] = "prog";
+  char arg1[] = "--verbsoe=1";
+  char *argv[] = {arg0, arg1, nullptr};
+  struct parg_state ps;
+  const struct parg_option longopts[] = {
+      {"verbose", PARG_OPTARG, nullptr, 'v'},
+      {"version", PARG_NOARG, nullptr, 'V'},
+      {"output", PARG_REQARG, nullptr, 'o'},
+      {"verify", PARG_NOARG, nullptr, 'y'},
+      {nullptr, PARG_NOARG, nullptr, 0},
+  };
+  struct parg_suggestion out[2];
+
+  parg_init(&ps);
+  ASSERT_EQ_INT(parg_getopt_long(&ps, 2, argv, "", longopts, nullptr), '?');
+  ASSERT_EQ_INT(ps.optopt, 0);
+  ASSERT_EQ_INT(parg_suggest(argv[ps.optind - 1] + 2, longopts, 3, out, 2),
+                2);
+  ASSERT_EQ_INT(out[0].index, 0);
+  ASSERT_EQ_INT(out[0].distance, 2);
+  ASSERT_EQ_INT(out[1].index, 1);
+  ASSERT_EQ_INT(out[1].distance, 3);
+
+  ASSERT_EQ_INT(parg_suggest("vers", longopts, 3, out, 2), 2);
+  ASSERT_EQ_INT(out[0].index, 0);
+  ASSERT_EQ_INT(out[1].index, 1);
+  ASSERT_EQ_INT(parg_suggest("outptu", longopts, 1, out, 2), 0);
+  ASSERT_EQ_INT(parg_suggest("outptu", longopts, 2, out, 2), 1);
+  ASSERT_EQ_INT(out[0].index, 2);
+  return 0;
+}
+
+static int test_defined_options_table() {
+  char arg0[] = "prog";
+  char arg1[] = "-vs3";
+  char arg2[] = "--dry-run";
+  char arg3[] = "--output";
+  char *argv[] = {arg0, arg1, arg2, arg3, nullptr};
+  struct parg_state ps;
+  int longindex = -1;
+
+  ASSERT_EQ_STR(table_optstring, ":hvo:s::");
+  ASSERT_EQ_STR(table_longopts[PARG_LONGINDEX(table, size)].name, "size");
+  ASSERT_EQ_INT(table_longopts[PARG_LONGINDEX(table, size)].has_arg,
+                PARG_OPTARG);
+  ASSERT_EQ_INT(table_longopts[PARG_NUM_LONGOPTS(table)].name == nullptr, 1);
+
+  parg_init(&ps);
+  ASSERT_EQ_INT(parg_getopt_long(&ps, 4, argv, table_optstring,
+                                 table_longopts, &longindex),
+                'v');
+  ASSERT_EQ_INT(parg_getopt_long(&ps, 4, argv, table_optstring,
+                                 table_longopts, &longindex),
+                's');
+  ASSERT_EQ_STR(ps.optarg, "3");
+  ASSERT_EQ_INT(parg_getopt_long(&ps, 4, argv, table_optstring,
+                                 table_longopts, &longindex),
+                256);
+  ASSERT_EQ_INT(longindex, PARG_LONGINDEX(table, dry_run));
+  ASSERT_EQ_INT(parg_getopt_long(&ps, 4, argv, table_optstring,
+                                 table_longopts, &longindex),
+                ':');
+  ASSERT_EQ_INT(ps.optopt, 'o');
+  return 0;
+}
+
 int main() {
   if (test_unknown_long_sets_optopt_zero() != 0) {
     return 1;
@@ -136,6 +327,18 @@ int main() {
   if (test_reorder_moves_options_first() != 0) {
     return 1;
   }
+  if (test_constraints_report_argv_indices() != 0) {
+    return 1;
+  }
+  if (test_constraints_short_cluster_conflicts() != 0) {
+    return 1;
+  }
+  if (test_suggest_orders_by_distance() != 0) {
+    return 1;
+  }
+  if (test_defined_options_table() != 0) {
+    return 1;
+  }
 
   puts("parg tests passed");
   return 0;
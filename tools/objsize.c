@@ -0,0 +1,291 @@
+/*
+ * objsize - report code and data size of ELF object files
+ *
+ * Usage: objsize [--allow-undefined=SYM,...] LABEL FILE [LABEL FILE ...]
+ *
+ * Sums the sizes of allocated sections in each relocatable object, split
+ * into text (executable), rodata (read-only data), data (writable data) and
+ * bss (zero-initialized data).
+ *
+ * With `--allow-undefined`, also fails if an object references an undefined
+ * symbol not in the comma-separated list.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static constexpr uint32_t SHT_SYMTAB = 2;
+static constexpr uint32_t SHT_NOBITS = 8;
+static constexpr uint64_t SHF_WRITE = 0x1;
+static constexpr uint64_t SHF_ALLOC = 0x2;
+static constexpr uint64_t SHF_EXECINSTR = 0x4;
+
+struct footprint {
+  uint64_t text;
+  uint64_t rodata;
+  uint64_t data;
+  uint64_t bss;
+};
+
+/* Read little-endian value of `size` bytes at `p`. */
+static uint64_t read_le(const unsigned char *p, int size) {
+  uint64_t v = 0;
+
+  for (int i = size - 1; i >= 0; --i) {
+    v = (v << 8) | p[i];
+  }
+
+  return v;
+}
+
+static unsigned char *read_file(const char *path, size_t *size) {
+  FILE *f = fopen(path, "rb");
+  unsigned char *buf = nullptr;
+  long len;
+
+  if (f == nullptr) {
+    return nullptr;
+  }
+
+  if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 &&
+      fseek(f, 0, SEEK_SET) == 0) {
+    buf = malloc((size_t)len);
+
+    if (buf != nullptr && fread(buf, 1, (size_t)len, f) != (size_t)len) {
+      free(buf);
+      buf = nullptr;
+    }
+
+    *size = (size_t)len;
+  }
+
+  fclose(f);
+  return buf;
+}
+
+struct elf {
+  const unsigned char *buf;
+  size_t size;
+  uint64_t shoff;
+  uint64_t shentsize;
+  uint64_t shnum;
+  bool is64;
+};
+
+/*
+ * Locate section headers of ELF object in `buf`.
+ *
+ * Returns `0` on success, `-1` if `buf` is not a little-endian ELF file.
+ */
+static int elf_open(struct elf *elf, const unsigned char *buf, size_t size) {
+  if (size < 52 || memcmp(buf, "\177ELF", 4) != 0 || buf[5] != 1) {
+    return -1;
+  }
+
+  elf->buf = buf;
+  elf->size = size;
+  elf->is64 = buf[4] == 2;
+
+  if (elf->is64 && size < 64) {
+    return -1;
+  }
+
+  elf->shoff = elf->is64 ? read_le(&buf[0x28], 8) : read_le(&buf[0x20], 4);
+  elf->shentsize = read_le(&buf[elf->is64 ? 0x3a : 0x2e], 2);
+  elf->shnum = read_le(&buf[elf->is64 ? 0x3c : 0x30], 2);
+
+  if (elf->shentsize < (elf->is64 ? 64u : 40u) || elf->shoff > size ||
+      elf->shnum > (size - elf->shoff) / elf->shentsize) {
+    return -1;
+  }
+
+  return 0;
+}
+
+static const unsigned char *elf_section(const struct elf *elf, uint64_t i) {
+  return &elf->buf[elf->shoff + i * elf->shentsize];
+}
+
+/*
+ * Sum section sizes of ELF object.
+ */
+static void elf_footprint(const struct elf *elf, struct footprint *fp) {
+  for (uint64_t i = 0; i < elf->shnum; ++i) {
+    const unsigned char *sh = elf_section(elf, i);
+    const uint32_t type = (uint32_t)read_le(&sh[4], 4);
+    const uint64_t flags =
+        elf->is64 ? read_le(&sh[8], 8) : read_le(&sh[8], 4);
+    const uint64_t sec_size =
+        elf->is64 ? read_le(&sh[0x20], 8) : read_le(&sh[0x14], 4);
+
+    if ((flags & SHF_ALLOC) == 0) {
+      continue;
+    }
+
+    if (flags & SHF_EXECINSTR) {
+      fp->text += sec_size;
+    } else if (type == SHT_NOBITS) {
+      fp->bss += sec_size;
+    } else if (flags & SHF_WRITE) {
+      fp->data += sec_size;
+    } else {
+      fp->rodata += sec_size;
+    }
+  }
+}
+
+/* Check if `name` is in comma-separated `list`. */
+static bool in_list(const char *list, const char *name) {
+  const size_t len = strlen(name);
+
+  while (*list != '\0') {
+    const size_t tok = strcspn(list, ",");
+
+    if (tok == len && strncmp(list, name, len) == 0) {
+      return true;
+    }
+
+    list += tok + (list[tok] == ',');
+  }
+
+  return false;
+}
+
+/*
+ * Print undefined symbols of ELF object that are not in `allowed`.
+ *
+ * Returns number of such symbols, or `-1` if the symbol table is malformed.
+ */
+static int elf_check_undefined(const struct elf *elf, const char *label,
+                               const char *allowed) {
+  int count = 0;
+
+  for (uint64_t i = 0; i < elf->shnum; ++i) {
+    const unsigned char *sh = elf_section(elf, i);
+    const bool is64 = elf->is64;
+    uint64_t off;
+    uint64_t size;
+    uint64_t link;
+    uint64_t entsize;
+    uint64_t stroff;
+    uint64_t strsize;
+
+    if ((uint32_t)read_le(&sh[4], 4) != SHT_SYMTAB) {
+      continue;
+    }
+
+    off = is64 ? read_le(&sh[0x18], 8) : read_le(&sh[0x10], 4);
+    size = is64 ? read_le(&sh[0x20], 8) : read_le(&sh[0x14], 4);
+    link = read_le(&sh[is64 ? 0x28 : 0x18], 4);
+    entsize = is64 ? read_le(&sh[0x38], 8) : read_le(&sh[0x24], 4);
+
+    if (link >= elf->shnum || entsize < (is64 ? 24u : 16u) ||
+        off > elf->size || size > elf->size - off) {
+      return -1;
+    }
+
+    sh = elf_section(elf, link);
+    stroff = is64 ? read_le(&sh[0x18], 8) : read_le(&sh[0x10], 4);
+    strsize = is64 ? read_le(&sh[0x20], 8) : read_le(&sh[0x14], 4);
+
+    if (stroff > elf->size || strsize > elf->size - stroff ||
+        memchr(&elf->buf[stroff], '\0', strsize) == nullptr) {
+      return -1;
+    }
+
+    for (uint64_t sym = off; sym + entsize <= off + size; sym += entsize) {
+      const unsigned char *st = &elf->buf[sym];
+      const uint64_t name = read_le(st, 4);
+      const uint64_t shndx = read_le(&st[is64 ? 6 : 14], 2);
+      const char *str;
+
+      if (shndx != 0 || name == 0) {
+        continue;
+      }
+
+      if (name >= strsize ||
+          memchr(&elf->buf[stroff + name], '\0', strsize - name) == nullptr) {
+        return -1;
+      }
+
+      str = (const char *)&elf->buf[stroff + name];
+
+      if (!in_list(allowed, str)) {
+        fprintf(stderr, "%s: unexpected undefined symbol %s\n", label, str);
+        ++count;
+      }
+    }
+  }
+
+  return count;
+}
+
+int main(int argc, char *argv[]) {
+  static const char allow_opt[] = "--allow-undefined=";
+  const char *allowed = nullptr;
+  int status = 0;
+  int first = 1;
+
+  if (argc > 1 &&
+      strncmp(argv[1], allow_opt, sizeof(allow_opt) - 1) == 0) {
+    allowed = &argv[1][sizeof(allow_opt) - 1];
+    first = 2;
+  }
+
+  if (argc - first < 2 || (argc - first) % 2 != 0) {
+    fprintf(stderr,
+            "Usage: %s [--allow-undefined=SYM,...] LABEL FILE "
+            "[LABEL FILE ...]\n",
+            argv[0]);
+    return 1;
+  }
+
+  for (int i = first; i < argc; i += 2) {
+    struct footprint fp = {0};
+    struct elf elf;
+    unsigned char *buf;
+    size_t size = 0;
+
+    buf = read_file(argv[i + 1], &size);
+
+    if (buf == nullptr) {
+      fprintf(stderr, "%s: unable to read %s\n", argv[i], argv[i + 1]);
+      return 1;
+    }
+
+    if (elf_open(&elf, buf, size) != 0) {
+      printf("%-12s (not a little-endian ELF object, size unknown)\n",
+             argv[i]);
+
+      if (allowed != nullptr) {
+        fprintf(stderr, "%s: unable to check undefined symbols\n", argv[i]);
+        status = 1;
+      }
+    } else {
+      elf_footprint(&elf, &fp);
+      printf("%-12s text=%llu rodata=%llu data=%llu bss=%llu total=%llu\n",
+             argv[i], (unsigned long long)fp.text,
+             (unsigned long long)fp.rodata, (unsigned long long)fp.data,
+             (unsigned long long)fp.bss,
+             (unsigned long long)(fp.text + fp.rodata + fp.data + fp.bss));
+
+      if (allowed != nullptr) {
+        const int undefined = elf_check_undefined(&elf, argv[i], allowed);
+
+        if (undefined < 0) {
+          fprintf(stderr, "%s: malformed symbol table\n", argv[i]);
+        }
+
+        if (undefined != 0) {
+          status = 1;
+        }
+      }
+    }
+
+    free(buf);
+  }
+
+  return status;
+}